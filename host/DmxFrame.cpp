@@ -0,0 +1,62 @@
+#include "config.h"
+
+#include "DmxFrame.h"
+
+#include "AvrUtils.h"
+#include "DMXSerial.h"
+#include "Timebase.h"
+
+#include <avr/io.h>
+
+extern "C" void TIMER1_COMPA_vect();
+extern "C" void USART_UDRE_vect();
+extern "C" void USART_TX_vect();
+
+// Time to send one byte at 250 kbaud, 8N2
+#define SLOT_TICKS TIMEBASE_US_TO_TICKS(44)
+// Time to send the break byte at 100 kbaud, 8E1
+#define BREAK_BYTE_TICKS TIMEBASE_US_TO_TICKS(110)
+
+// Advances the timer to the compare match and runs the interrupt
+static void compareMatchA() {
+    TCNT1 = OCR1A;
+    TIMER1_COMPA_vect();
+}
+
+uint16_t sendDmxFrame(uint8_t* slots, uint16_t maxSlots) {
+#ifdef DMX_TIMER_BREAK
+    // Break, then mark after break. Start code is written at the end of mark
+    // after break.
+    compareMatchA();
+    compareMatchA();
+#else
+    // Break byte sent at low baud rate. Start code is written after it.
+    TCNT1 += BREAK_BYTE_TICKS;
+    USART_TX_vect();
+#endif
+
+    uint16_t count = 0;
+    if (count < maxSlots) {
+        slots[count] = UDR0;
+    }
+    count++;
+
+    while (UCSR0B & BV(UDRIE0)) {
+        TCNT1 += SLOT_TICKS;
+        USART_UDRE_vect();
+        if (count < maxSlots) {
+            slots[count] = UDR0;
+        }
+        count++;
+    }
+
+    // Last byte done. An idle gap may be inserted before the next break. During
+    // the gap, only the transmitter is enabled.
+    TCNT1 += SLOT_TICKS;
+    USART_TX_vect();
+    for (uint8_t i = 0; UCSR0B == BV(TXEN0) && i < 100; i++) {
+        compareMatchA();
+    }
+
+    return count;
+}
@@ -0,0 +1,24 @@
+// Drives the DMXSerial interrupt service routines through one frame, as the
+// USART and timer 1 would on the target. Timer 1 advances by the time each
+// byte takes to send and up to each compare match.
+
+#ifndef _H_DMX_FRAME
+#define _H_DMX_FRAME
+
+#include <stdint.h>
+
+/// \brief
+///    Sends one frame, starting from a break in progress and ending in the
+///    next break. The break is ended by timer 1 compare A with
+///    DMX_TIMER_BREAK, or by the usart transmit complete interrupt without.
+///
+/// \param slots
+///    Destination for sent slots, start code first
+/// \param maxSlots
+///    Size of slots
+///
+/// \return
+///    Number of slots sent, including the start code
+uint16_t sendDmxFrame(uint8_t* slots, uint16_t maxSlots);
+
+#endif
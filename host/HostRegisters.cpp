@@ -0,0 +1,22 @@
+#include <avr/io.h>
+#include <avr/sleep.h>
+
+#define HOST_DEFINE_REGISTER(name, type) volatile type name = type();
+HOST_REGISTERS(HOST_DEFINE_REGISTER)
+#undef HOST_DEFINE_REGISTER
+
+void (*hostUsartWriteHook)(uint8_t data) = 0;
+void (*hostSleepHook)() = 0;
+
+void HostUsartData::operator=(uint8_t data) volatile {
+    value = data;
+    if (hostUsartWriteHook) {
+        hostUsartWriteHook(data);
+    }
+}
+
+void resetHostRegisters() {
+#define HOST_RESET_REGISTER(name, type) name = 0;
+    HOST_REGISTERS(HOST_RESET_REGISTER)
+#undef HOST_RESET_REGISTER
+}
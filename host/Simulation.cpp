@@ -0,0 +1,386 @@
+#include "config.h"
+
+#include "Simulation.h"
+
+#include "AvrUtils.h"
+#include "PinChange.h"
+#include "Timebase.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/sleep.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Firmware main program, renamed
+int firmwareMain();
+
+extern "C" void TIMER0_COMPA_vect();
+extern "C" void TIMER1_COMPA_vect();
+extern "C" void TIMER1_COMPB_vect();
+extern "C" void USART_UDRE_vect();
+extern "C" void USART_TX_vect();
+
+#define ECHO_VECTOR_(port) PIN_CHANGE_VECTOR_##port
+#define ECHO_VECTOR(port) ECHO_VECTOR_(port)
+extern "C" void ECHO_VECTOR(DISTANCE_SENSOR_ECHO_PORT)();
+
+// Simulation time is kept in timebase ticks
+static const uint64_t TICKS_PER_US = TIMEBASE_US_TO_TICKS(1);
+
+// HC-SR04 sends its ultrasound burst after the trigger, before raising the
+// echo
+static const uint64_t ECHO_START_DELAY = TIMEBASE_US_TO_TICKS(500);
+// HC-SR04 echo length when nothing is in range
+static const uint64_t NO_TARGET_ECHO_LENGTH = TIMEBASE_US_TO_TICKS(38000);
+
+// Usart baud rate register value of dmx data. Bytes sent at any other rate
+// are breaks.
+static const uint16_t DMX_BAUD_SETTING = F_CPU / 16 / 250000 - 1;
+
+// Sensor pins
+static const uint8_t TRIGGER_PINS[] = DISTANCE_SENSOR_TRIGGER_PINS;
+static const uint8_t ECHO_PINS[] = DISTANCE_SENSOR_ECHO_PINS;
+
+typedef PortRegisters<DISTANCE_SENSOR_TRIGGER_PORT> TriggerPort;
+typedef PortRegisters<DISTANCE_SENSOR_ECHO_PORT> EchoPort;
+typedef PinChangeRegisters<DISTANCE_SENSOR_ECHO_PORT> EchoPinChange;
+
+// Echo pin level change waiting to happen
+struct EchoEdge {
+    uint64_t time;
+    uint8_t pin;
+    bool level;
+};
+
+// Rising and falling edge for each sensor
+static const uint8_t MAX_EDGES = 2 * DISTANCE_SENSOR_COUNT;
+
+// Simulation state
+static uint64_t now;
+static uint64_t endTime;
+static jmp_buf finished;
+static EchoSource echoSource;
+static FrameSink frameSink;
+
+// Timer 1 compare matches waiting for their interrupt, like the OCF1x flags
+static bool isCompareAPending;
+static bool isCompareBPending;
+
+// Time of next scheduler tick, or 0 if timer 0 has not been started
+static uint64_t nextTick;
+
+// Pending echo edges
+static EchoEdge edges[MAX_EDGES];
+static uint8_t edgeCount;
+
+// Usart transmitter. The data register holds one byte while another one is
+// being shifted out.
+static bool isShifting;
+static uint64_t shiftEnd;
+static bool isBufferFull;
+static uint8_t bufferData;
+static bool isTransmitComplete;
+
+// Frame being received
+static bool isBreakSeen;
+static bool isFrameOpen;
+static uint64_t frameTime;
+static uint8_t frame[513];
+static uint16_t frameCount;
+
+// Runs an interrupt service routine with interrupts disabled, like the cpu
+static void interrupt(void (*vector)()) {
+    uint8_t sreg = SREG;
+    cli();
+    vector();
+    SREG = sreg;
+}
+
+// Scheduler tick period. Scheduler runs timer 0 in CTC mode with prescaler 64.
+static uint64_t tickTicks() {
+    return (uint64_t)(OCR0A + 1) * 64 / TIMEBASE_PRESCALER;
+}
+
+// Length of a usart byte, from baud rate and frame format
+static uint64_t byteTicks() {
+    uint8_t bits = 1 + 8 + ((UCSR0C & BV(USBS0)) ? 2 : 1);
+    if (UCSR0C & BV(UPM01)) {
+        bits++;
+    }
+    uint16_t setting = (UBRR0H << 8) | UBRR0L;
+    uint8_t divider = (UCSR0A & BV(U2X0)) ? 8 : 16;
+    return (uint64_t)bits * divider * (setting + 1) / TIMEBASE_PRESCALER;
+}
+
+// Handles a byte appearing on the line
+static void receiveByte(uint8_t data) {
+    uint16_t setting = (UBRR0H << 8) | UBRR0L;
+    if (setting != DMX_BAUD_SETTING) {
+        isBreakSeen = true;
+        return;
+    }
+
+    if (isBreakSeen) {
+        if (isFrameOpen) {
+            frameSink(frameTime / TICKS_PER_US, frame, frameCount);
+        }
+        isBreakSeen = false;
+        isFrameOpen = true;
+        frameTime = now;
+        frameCount = 0;
+    }
+
+    if (isFrameOpen && frameCount < sizeof(frame)) {
+        frame[frameCount++] = data;
+    }
+}
+
+static void startShift(uint8_t data) {
+    isShifting = true;
+    shiftEnd = now + byteTicks();
+    receiveByte(data);
+}
+
+// Called on every write to the usart data register
+static void usartWrite(uint8_t data) {
+    if (!(UCSR0B & BV(TXEN0))) {
+        return;
+    }
+
+    isTransmitComplete = false;
+    if (isShifting) {
+        isBufferFull = true;
+        bufferData = data;
+    }
+    else {
+        startShift(data);
+    }
+}
+
+// Tells if echo of the given pin has not ended yet
+static bool isEchoPending(uint8_t pin) {
+    for (uint8_t i = 0; i < edgeCount; i++) {
+        if (edges[i].pin == pin) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Starts echoes of sensors whose trigger pulse just ended
+static void checkTriggers(uint8_t previousTriggers) {
+    uint8_t falling = previousTriggers & ~TriggerPort::data();
+
+    for (uint8_t i = 0; i < DISTANCE_SENSOR_COUNT; i++) {
+        if (!(falling & BV(TRIGGER_PINS[i]))) {
+            continue;
+        }
+        // Sensor ignores triggers until its echo has ended
+        if (isEchoPending(ECHO_PINS[i])) {
+            continue;
+        }
+
+        SimulatedEcho echo = echoSource(now / TICKS_PER_US, i);
+        if (echo.status == DISTANCE_SENSOR_FAULT) {
+            continue;
+        }
+
+        uint64_t length = echo.status == DISTANCE_VALID ?
+            echo.length * TICKS_PER_US :
+            NO_TARGET_ECHO_LENGTH;
+        uint64_t start = now + ECHO_START_DELAY;
+        edges[edgeCount++] = { start, ECHO_PINS[i], true };
+        edges[edgeCount++] = { start + length, ECHO_PINS[i], false };
+    }
+}
+
+// Time of next compare match of a timer 1 compare register. A match with the
+// current counter value happens only after a full period. A match that has
+// already happened is pending at once.
+static uint64_t compareTime(uint16_t compare, bool isPending) {
+    if (isPending) {
+        return now;
+    }
+    return now + (uint16_t)(compare - (uint16_t)now - 1) + 1;
+}
+
+// Kinds of events, in order of priority when they happen at the same time.
+// Pin level changes come first, interrupts follow in vector order.
+enum EventKind {
+    EVENT_SHIFT_END,
+    EVENT_ECHO_EDGE,
+    EVENT_COMPARE_A,
+    EVENT_COMPARE_B,
+    EVENT_TICK,
+    EVENT_DATA_EMPTY,
+    EVENT_TRANSMIT_COMPLETE,
+    EVENT_END
+};
+
+// Takes a candidate as the next event if it is earlier than the current one,
+// or happens at the same time and has higher priority
+static void consider(
+    uint64_t candidateTime,
+    EventKind candidateKind,
+    uint64_t& time,
+    EventKind& kind
+) {
+    if (
+        candidateTime < time
+            || (candidateTime == time && candidateKind < kind)
+    ) {
+        time = candidateTime;
+        kind = candidateKind;
+    }
+}
+
+// Advances time to the next event and handles it
+static void step() {
+    if (!(SREG & 0x80)) {
+        fprintf(stderr, "Firmware went to sleep with interrupts disabled\n");
+        exit(1);
+    }
+
+    // Usart disabled means the line is held low for a timed break
+    if (!(UCSR0B & BV(TXEN0))) {
+        isBreakSeen = true;
+    }
+
+    uint64_t time = endTime;
+    EventKind kind = EVENT_END;
+    uint8_t edge = 0;
+
+    if (isShifting) {
+        consider(shiftEnd, EVENT_SHIFT_END, time, kind);
+    }
+    for (uint8_t i = 0; i < edgeCount; i++) {
+        if (edges[i].time < time) {
+            time = edges[i].time;
+            kind = EVENT_ECHO_EDGE;
+            edge = i;
+        }
+    }
+    if (TIMSK1 & BV(OCIE1A)) {
+        consider(
+            compareTime(OCR1A, isCompareAPending),
+            EVENT_COMPARE_A,
+            time,
+            kind
+        );
+    }
+    if (TIMSK1 & BV(OCIE1B)) {
+        consider(
+            compareTime(OCR1B, isCompareBPending),
+            EVENT_COMPARE_B,
+            time,
+            kind
+        );
+    }
+    if (TIMSK0 & BV(OCIE0A)) {
+        if (nextTick == 0) {
+            nextTick = now + tickTicks();
+        }
+        consider(nextTick, EVENT_TICK, time, kind);
+    }
+    if ((UCSR0B & BV(TXEN0)) && (UCSR0B & BV(UDRIE0)) && !isBufferFull) {
+        consider(now, EVENT_DATA_EMPTY, time, kind);
+    }
+    if (isTransmitComplete && (UCSR0B & BV(TXCIE0))) {
+        consider(now, EVENT_TRANSMIT_COMPLETE, time, kind);
+    }
+
+    // Compare matches passed on the way stay pending, even if another event
+    // is handled first. Matches of disabled compare interrupts are not kept,
+    // since the firmware clears the flag before enabling the interrupt.
+    if (
+        (TIMSK1 & BV(OCIE1A))
+            && compareTime(OCR1A, isCompareAPending) <= time
+    ) {
+        isCompareAPending = true;
+    }
+    if (
+        (TIMSK1 & BV(OCIE1B))
+            && compareTime(OCR1B, isCompareBPending) <= time
+    ) {
+        isCompareBPending = true;
+    }
+
+    now = time;
+    TCNT1 = (uint16_t)now;
+
+    switch (kind) {
+        case EVENT_SHIFT_END:
+            if (isBufferFull) {
+                isBufferFull = false;
+                startShift(bufferData);
+            }
+            else {
+                isShifting = false;
+                isTransmitComplete = true;
+            }
+            break;
+        case EVENT_ECHO_EDGE:
+            if (edges[edge].level) {
+                EchoPort::input() |= BV(edges[edge].pin);
+            }
+            else {
+                EchoPort::input() &= ~BV(edges[edge].pin);
+            }
+            if (
+                (PCICR & BV(EchoPinChange::enableBit))
+                    && (EchoPinChange::mask() & BV(edges[edge].pin))
+            ) {
+                interrupt(ECHO_VECTOR(DISTANCE_SENSOR_ECHO_PORT));
+            }
+            edges[edge] = edges[--edgeCount];
+            break;
+        case EVENT_COMPARE_A:
+            isCompareAPending = false;
+            interrupt(TIMER1_COMPA_vect);
+            break;
+        case EVENT_COMPARE_B: {
+            uint8_t triggers = TriggerPort::data();
+            isCompareBPending = false;
+            interrupt(TIMER1_COMPB_vect);
+            checkTriggers(triggers);
+            break;
+        }
+        case EVENT_TICK:
+            nextTick += tickTicks();
+            interrupt(TIMER0_COMPA_vect);
+            break;
+        case EVENT_DATA_EMPTY:
+            interrupt(USART_UDRE_vect);
+            break;
+        case EVENT_TRANSMIT_COMPLETE:
+            isTransmitComplete = false;
+            interrupt(USART_TX_vect);
+            break;
+        case EVENT_END:
+            longjmp(finished, 1);
+    }
+}
+
+void runSimulation(
+    uint64_t duration,
+    EchoSource source,
+    FrameSink sink
+) {
+    now = 0;
+    endTime = duration * TICKS_PER_US;
+    echoSource = source;
+    frameSink = sink;
+
+    hostSleepHook = step;
+    hostUsartWriteHook = usartWrite;
+
+    // Does not return. Simulation ends by jumping back here.
+    if (setjmp(finished) == 0) {
+        firmwareMain();
+    }
+
+    hostSleepHook = 0;
+    hostUsartWriteHook = 0;
+}
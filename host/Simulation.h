@@ -0,0 +1,77 @@
+// Runs the firmware main program on the build host in virtual time.
+//
+// Time passes only while the firmware sleeps. Each sleep advances time to the
+// next hardware event and runs the interrupt service routine it triggers, so
+// code between sleeps takes no time at all. Hardware is modeled as far as the
+// firmware uses it: the timer 0 compare A tick, timer 1 compare units A and B,
+// the trigger and echo pins of the distance sensors and the usart transmitter.
+// Runs are fully deterministic.
+//
+// The firmware main program must be compiled with its main() renamed to
+// firmwareMain().
+
+#ifndef _H_SIMULATION
+#define _H_SIMULATION
+
+#include "DistanceSensorController.h"
+
+#include <stdint.h>
+
+/// \struct SimulatedEcho
+///
+/// Response of a distance sensor to a single ping.
+struct SimulatedEcho {
+    /// DISTANCE_VALID for an echo from a target, DISTANCE_OUT_OF_RANGE for
+    /// the long echo the sensor gives when nothing is in range, or
+    /// DISTANCE_SENSOR_FAULT for no echo at all
+    DistanceStatus status;
+    /// Echo length in microseconds. Only used for DISTANCE_VALID.
+    uint16_t length;
+};
+
+/// \brief
+///    Gives the response of a sensor to a ping. Called when the trigger pulse
+///    ends.
+///
+/// \param time
+///    Simulation time in microseconds
+///
+/// \param sensor
+///    Sensor index
+///
+/// \return
+///    Echo of the sensor
+typedef SimulatedEcho (*EchoSource)(uint64_t time, uint8_t sensor);
+
+/// \brief
+///    Receives a dmx frame. Called when the break after the frame starts, so
+///    the last frame of a run is not received.
+///
+/// \param time
+///    Simulation time when the start code was sent, in microseconds
+///
+/// \param slots
+///    Start code and data slots
+///
+/// \param count
+///    Number of slots, including the start code
+typedef void (*FrameSink)(uint64_t time, const uint8_t* slots, uint16_t count);
+
+/// \brief
+///    Runs the firmware from reset until the given time.
+///
+/// \param duration
+///    Simulation end time in microseconds
+///
+/// \param echoSource
+///    Responses of the distance sensors
+///
+/// \param frameSink
+///    Receiver of dmx frames
+void runSimulation(
+    uint64_t duration,
+    EchoSource echoSource,
+    FrameSink frameSink
+);
+
+#endif
@@ -0,0 +1,199 @@
+// Micro-benchmarks of firmware hot paths, run natively on the build host.
+// Host timings do not predict avr cycle counts, but they show relative cost
+// and catch regressions between firmware versions. Cycle counts on the target
+// are measured with INSTRUMENTATION instead.
+
+#include "config.h"
+
+#include "AvrUtils.h"
+#include "DmxFrame.h"
+#include "DMXSerial.h"
+#include "DistanceFilter.h"
+#include "DistanceSensorController.h"
+#include "FastRandom.h"
+#include "FixtureProfile.h"
+#include "FlickeringDmxController.h"
+#include "Timebase.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+extern "C" void PCINT1_vect();
+extern "C" void TIMER1_COMPB_vect();
+extern "C" void USART_UDRE_vect();
+
+// Next dmx slot to send, from DMXSerial.cpp
+extern int _dmxChannel;
+
+/// Number of calls per benchmark
+#define ITERATIONS 1000000L
+
+static const uint8_t ECHO_PINS[] = DISTANCE_SENSOR_ECHO_PINS;
+
+// Keeps results of benchmarked code, so that the compiler cannot remove it
+static volatile uint32_t sink;
+
+// Returns monotonic time in nanoseconds
+static uint64_t now() {
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+static void report(const char* name, uint64_t nanoseconds, long calls) {
+    printf("%-32s %8.1f ns\n", name, (double)nanoseconds / calls);
+}
+
+static void benchmarkPins() {
+    uint64_t start = now();
+    for (long i = 0; i < ITERATIONS; i++) {
+        Pin<C, 0>::set();
+        Pin<C, 0>::clear();
+    }
+    report("Pin set and clear", now() - start, ITERATIONS);
+
+    start = now();
+    for (long i = 0; i < ITERATIONS; i++) {
+        setData(C, 0, true);
+        setData(C, 0, false);
+    }
+    report("setData() set and clear", now() - start, ITERATIONS);
+}
+
+static void benchmarkPing() {
+    DistanceSensorController controller;
+    DistanceMeasurement measurement;
+    controller.start();
+
+    // Each ping runs the compare interrupt at the end of recovery and at the
+    // end of trigger, the echo interrupt at both edges, and read()
+    uint64_t start = now();
+    for (long i = 0; i < ITERATIONS; i++) {
+        TCNT1 = OCR1B;
+        TIMER1_COMPB_vect();
+        TCNT1 = OCR1B;
+        TIMER1_COMPB_vect();
+        TCNT1 += 1000;
+        PINC |= BV(ECHO_PINS[0]);
+        PCINT1_vect();
+        TCNT1 += 5000;
+        PINC &= ~BV(ECHO_PINS[0]);
+        PCINT1_vect();
+        controller.read(measurement);
+    }
+    report("Ping and read()", now() - start, ITERATIONS);
+}
+
+static void benchmarkFilter() {
+    // Target at 1.5 m with a few millimeters of noise, and a spike of up to
+    // 2 m on every 16th sample
+    static uint16_t trace[256];
+    FastRandom random(1);
+    for (uint16_t i = 0; i < 256; i++) {
+        trace[i] = 1500 + random.below(16);
+        if (i % 16 == 0) {
+            trace[i] += random.next() % 2000;
+        }
+    }
+
+    DistanceFilter filter;
+    uint64_t start = now();
+    for (long i = 0; i < ITERATIONS; i++) {
+        sink = filter.add(trace[i & 0xff]);
+    }
+    report("DistanceFilter::add, noisy", now() - start, ITERATIONS);
+}
+
+static void benchmarkDistanceConversion() {
+    // Fixed point factor as in DistanceSensorController.cpp, and the floating
+    // point one it replaced
+    const uint16_t MM_PER_TICK_Q16 = (
+        (uint64_t)DISTANCE_SENSOR_MM_PER_MS * 1000 * TIMEBASE_PRESCALER
+            * 65536 + F_CPU / 2
+    ) / F_CPU;
+    const float MM_PER_TICK =
+        (float)DISTANCE_SENSOR_MM_PER_MS * 1000 * TIMEBASE_PRESCALER / F_CPU;
+
+    uint64_t start = now();
+    for (long i = 0; i < ITERATIONS; i++) {
+        uint16_t delay = i;
+        sink = ((uint32_t)delay * MM_PER_TICK_Q16) >> 16;
+    }
+    report("Distance conversion, integer", now() - start, ITERATIONS);
+
+    start = now();
+    for (long i = 0; i < ITERATIONS; i++) {
+        uint16_t delay = i;
+        sink = (uint16_t)(MM_PER_TICK * delay);
+    }
+    report("Distance conversion, float", now() - start, ITERATIONS);
+}
+
+static void benchmarkRandom() {
+    // Limit is read from memory, like the fixture intensities, so that the
+    // modulo is not turned into a multiplication
+    static volatile uint8_t limit = 60;
+
+    FastRandom random(FLICKER_RANDOM_SEED);
+    uint64_t start = now();
+    for (long i = 0; i < ITERATIONS; i++) {
+        sink = random.below(limit);
+    }
+    report("FastRandom::below", now() - start, ITERATIONS);
+
+    srand(FLICKER_RANDOM_SEED);
+    start = now();
+    for (long i = 0; i < ITERATIONS; i++) {
+        sink = rand() % limit;
+    }
+    report("rand() %", now() - start, ITERATIONS);
+}
+
+static void benchmarkDmxSlot() {
+    DMXSerial.init();
+
+    uint64_t start = now();
+    for (long i = 0; i < ITERATIONS; i++) {
+        _dmxChannel = 1;
+        USART_UDRE_vect();
+    }
+    report("USART_UDRE_vect", now() - start, ITERATIONS);
+}
+
+static void benchmarkEffect() {
+    FlickeringDmxController dmx;
+    for (uint8_t i = 0; i < FLICKER_MAX_CHANNELS; i++) {
+        dmx.addFixture(DIMMER_PROFILE, i + 1, 128, 60, WAVEFORM_CANDLE);
+    }
+    dmx.setFlickerEnabled(true);
+
+    // Each run commits, so a frame is sent between runs to swap the buffers.
+    // Only run() is timed.
+    uint8_t slots[DMXSERIAL_MAX + 1];
+    long runs = ITERATIONS / 10;
+    uint64_t total = 0;
+    for (long i = 0; i < runs; i++) {
+        uint64_t start = now();
+        dmx.run();
+        total += now() - start;
+        sendDmxFrame(slots, sizeof(slots));
+    }
+    report("FlickeringDmxController::run", total, runs);
+}
+
+int main() {
+    sei();
+
+    benchmarkPins();
+    benchmarkPing();
+    benchmarkFilter();
+    benchmarkDistanceConversion();
+    benchmarkRandom();
+    benchmarkDmxSlot();
+    benchmarkEffect();
+
+    return 0;
+}
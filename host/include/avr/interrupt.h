@@ -0,0 +1,23 @@
+// Host stand-in for avr-libc <avr/interrupt.h>. Interrupt service routines
+// become ordinary C functions named after their vectors, so that tests can
+// call them, e.g. PCINT1_vect(). Global interrupt enable is kept in bit 7 of
+// SREG.
+
+#ifndef _H_HOST_AVR_INTERRUPT
+#define _H_HOST_AVR_INTERRUPT
+
+#include <avr/io.h>
+
+#define ISR(vector) \
+    extern "C" void vector(); \
+    extern "C" void vector()
+
+inline void sei() {
+    SREG |= 0x80;
+}
+
+inline void cli() {
+    SREG &= ~0x80;
+}
+
+#endif
@@ -0,0 +1,166 @@
+// Host stand-in for avr-libc <avr/io.h>. Io registers of the atmega328p used
+// by the firmware are plain variables, defined in host/HostRegisters.cpp, so
+// that firmware sources compile and run on the build host. Tests set input
+// registers and inspect output registers directly.
+//
+// Registers have no side effects. In particular, writing to PINx does not
+// toggle PORTx and writing one to a TIFRx bit does not clear it. The only
+// exception is UDR0, whose writes can be observed through hostUsartWriteHook.
+
+#ifndef _H_HOST_AVR_IO
+#define _H_HOST_AVR_IO
+
+#include <stdint.h>
+
+/// \struct HostUsartData
+///
+/// Usart data register. Written bytes are passed to hostUsartWriteHook, if
+/// set, so that a simulation can follow the transmission.
+struct HostUsartData {
+    uint8_t value;
+
+    void operator=(uint8_t data) volatile;
+
+    operator uint8_t() const volatile {
+        return value;
+    }
+};
+
+/// Called on every write to UDR0, if set
+extern void (*hostUsartWriteHook)(uint8_t data);
+
+/// All registers, as X(name, type). Used for declaring, defining and resetting
+/// the registers.
+#define HOST_REGISTERS(X) \
+    X(PINB, uint8_t) X(PORTB, uint8_t) X(DDRB, uint8_t) \
+    X(PINC, uint8_t) X(PORTC, uint8_t) X(DDRC, uint8_t) \
+    X(PIND, uint8_t) X(PORTD, uint8_t) X(DDRD, uint8_t) \
+    X(TCCR0A, uint8_t) X(TCCR0B, uint8_t) X(TCNT0, uint8_t) \
+    X(OCR0A, uint8_t) X(OCR0B, uint8_t) X(TIMSK0, uint8_t) X(TIFR0, uint8_t) \
+    X(TCCR1A, uint8_t) X(TCCR1B, uint8_t) X(TCCR1C, uint8_t) \
+    X(TCNT1, uint16_t) X(OCR1A, uint16_t) X(OCR1B, uint16_t) \
+    X(ICR1, uint16_t) X(TIMSK1, uint8_t) X(TIFR1, uint8_t) \
+    X(TCCR2A, uint8_t) X(TCCR2B, uint8_t) X(TCNT2, uint8_t) \
+    X(OCR2A, uint8_t) X(OCR2B, uint8_t) X(TIMSK2, uint8_t) X(TIFR2, uint8_t) \
+    X(PCICR, uint8_t) X(PCIFR, uint8_t) \
+    X(PCMSK0, uint8_t) X(PCMSK1, uint8_t) X(PCMSK2, uint8_t) \
+    X(UCSR0A, uint8_t) X(UCSR0B, uint8_t) X(UCSR0C, uint8_t) \
+    X(UBRR0H, uint8_t) X(UBRR0L, uint8_t) X(UDR0, HostUsartData) \
+    X(ADCSRA, uint8_t) X(ACSR, uint8_t) X(DIDR0, uint8_t) X(DIDR1, uint8_t) \
+    X(PRR, uint8_t) X(SMCR, uint8_t) X(MCUSR, uint8_t) X(SREG, uint8_t)
+
+#define HOST_DECLARE_REGISTER(name, type) extern volatile type name;
+HOST_REGISTERS(HOST_DECLARE_REGISTER)
+#undef HOST_DECLARE_REGISTER
+
+/// \brief
+///    Sets all registers to zero.
+void resetHostRegisters();
+
+// Timer 0
+#define CS00 0
+#define CS01 1
+#define CS02 2
+#define WGM00 0
+#define WGM01 1
+#define WGM02 3
+#define TOIE0 0
+#define OCIE0A 1
+#define OCIE0B 2
+#define TOV0 0
+#define OCF0A 1
+#define OCF0B 2
+
+// Timer 1
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM10 0
+#define WGM11 1
+#define WGM12 3
+#define WGM13 4
+#define ICES1 6
+#define ICNC1 7
+#define TOIE1 0
+#define OCIE1A 1
+#define OCIE1B 2
+#define ICIE1 5
+#define TOV1 0
+#define OCF1A 1
+#define OCF1B 2
+#define ICF1 5
+
+// Timer 2
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM20 0
+#define WGM21 1
+#define WGM22 3
+
+// Pin change interrupts
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+
+// USART 0
+#define MPCM0 0
+#define U2X0 1
+#define UDRE0 5
+#define TXC0 6
+#define RXC0 7
+#define TXB80 0
+#define UCSZ02 2
+#define TXEN0 3
+#define RXEN0 4
+#define UDRIE0 5
+#define TXCIE0 6
+#define RXCIE0 7
+#define UCPOL0 0
+#define UCSZ00 1
+#define UCSZ01 2
+#define USBS0 3
+#define UPM00 4
+#define UPM01 5
+
+// Analog
+#define ADEN 7
+#define ACD 7
+
+// Power reduction
+#define PRADC 0
+#define PRUSART0 1
+#define PRSPI 2
+#define PRTIM1 3
+#define PRTIM0 5
+#define PRTIM2 6
+#define PRTWI 7
+
+// Port pins
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+
+#define RAMEND 0x8ff
+
+#endif
@@ -0,0 +1,14 @@
+// Host stand-in for avr-libc <avr/pgmspace.h>. Host has a single address
+// space, so program memory is read like any other memory.
+
+#ifndef _H_HOST_AVR_PGMSPACE
+#define _H_HOST_AVR_PGMSPACE
+
+#include <stdint.h>
+
+#define PROGMEM
+
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+
+#endif
@@ -0,0 +1,25 @@
+// Host stand-in for avr-libc <avr/sleep.h>. Sleeping does nothing, unless a
+// simulation has set hostSleepHook. The hook lets time pass and runs the
+// interrupts that would have woken the cpu.
+
+#ifndef _H_HOST_AVR_SLEEP
+#define _H_HOST_AVR_SLEEP
+
+#include <stdint.h>
+
+#define SLEEP_MODE_IDLE 0
+
+/// Called by sleep_cpu(), if set
+extern void (*hostSleepHook)();
+
+inline void set_sleep_mode(uint8_t) {}
+inline void sleep_enable() {}
+inline void sleep_disable() {}
+
+inline void sleep_cpu() {
+    if (hostSleepHook) {
+        hostSleepHook();
+    }
+}
+
+#endif
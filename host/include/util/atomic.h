@@ -0,0 +1,32 @@
+// Host stand-in for avr-libc <util/atomic.h>. Interrupts are disabled for the
+// block through SREG and restored after it, like on the target.
+
+#ifndef _H_HOST_UTIL_ATOMIC
+#define _H_HOST_UTIL_ATOMIC
+
+#include <avr/io.h>
+
+/// Restores SREG when an atomic block ends
+struct HostAtomicGuard {
+    uint8_t saved;
+
+    HostAtomicGuard() : saved(SREG) {
+        SREG &= ~0x80;
+    }
+
+    ~HostAtomicGuard() {
+        SREG = saved;
+    }
+};
+
+#define ATOMIC_BLOCK(type) \
+    for ( \
+        HostAtomicGuard _atomicGuard, *_atomicOnce = &_atomicGuard; \
+        _atomicOnce; \
+        _atomicOnce = 0 \
+    )
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+
+#endif
@@ -0,0 +1,9 @@
+// Host stand-in for avr-libc <util/delay.h>. Delays return at once.
+
+#ifndef _H_HOST_UTIL_DELAY
+#define _H_HOST_UTIL_DELAY
+
+inline void _delay_ms(double) {}
+inline void _delay_us(double) {}
+
+#endif
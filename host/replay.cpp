@@ -0,0 +1,252 @@
+// Replays a recorded distance sensor trace through the firmware on the build
+// host, and prints the resulting dmx frames with timestamps.
+//
+// Usage: replay [-a] [-b] [-t tail] trace
+//
+//   -a       Print all frames. By default, only frames that differ from the
+//            previous frame are printed.
+//   -b       Trace is a binary memory dump of variable echoTrace, recorded with
+//            ECHO_TRACE defined in config.h. ECHO_TRACE_LENGTH must be the same
+//            as when recording.
+//   -t tail  Time to keep running after the last ping of the trace, given in
+//            milliseconds. Default is 5000.
+//
+// A text trace has one ping per line, as
+//
+//   <time> <sensor> <echo>
+//
+// where time is given in milliseconds from the start of the trace and echo is
+// the echo length in microseconds, "out-of-range" or "fault". Empty lines and
+// lines starting with # are ignored.
+//
+// Sensors answer each ping with the latest trace entry of the sensor that is
+// not later than the ping, so the trace is replayed in real time even if the
+// firmware pings at a different rate than when recording.
+//
+// Output has one line per event, as
+//
+//   <time> echo <sensor> <echo>
+//   <time> frame <slot 0> <slot 1> ...
+//
+// where time is given in microseconds from reset, echo is as in the trace and
+// slots are in hexadecimal. Frames are timed by their start code.
+
+#include "config.h"
+
+#include "Simulation.h"
+#include "Timebase.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+// Single ping of the trace
+struct TraceEntry {
+    uint32_t time;
+    uint8_t sensor;
+    SimulatedEcho echo;
+};
+
+static std::vector<TraceEntry> trace;
+
+static bool isAllFramesPrinted = false;
+static std::vector<uint8_t> previousFrame;
+
+static void printEcho(const SimulatedEcho& echo) {
+    switch (echo.status) {
+        case DISTANCE_VALID:
+            printf("%u", echo.length);
+            break;
+        case DISTANCE_OUT_OF_RANGE:
+            printf("out-of-range");
+            break;
+        case DISTANCE_SENSOR_FAULT:
+            printf("fault");
+            break;
+    }
+}
+
+static SimulatedEcho answerPing(uint64_t time, uint8_t sensor) {
+    // Sensors missing from the trace are not connected
+    SimulatedEcho echo = { DISTANCE_SENSOR_FAULT, 0 };
+    bool isFound = false;
+    for (size_t i = 0; i < trace.size(); i++) {
+        if (trace[i].sensor != sensor) {
+            continue;
+        }
+        // Before the first ping of the sensor, its first ping is used
+        if (isFound && trace[i].time * 1000ULL > time) {
+            break;
+        }
+        echo = trace[i].echo;
+        isFound = true;
+    }
+
+    printf("%llu echo %d ", (unsigned long long)time, sensor);
+    printEcho(echo);
+    printf("\n");
+    return echo;
+}
+
+static void printFrame(uint64_t time, const uint8_t* slots, uint16_t count) {
+    std::vector<uint8_t> current(slots, slots + count);
+    if (!isAllFramesPrinted && current == previousFrame) {
+        return;
+    }
+    previousFrame = current;
+
+    printf("%llu frame", (unsigned long long)time);
+    for (uint16_t i = 0; i < count; i++) {
+        printf(" %02x", slots[i]);
+    }
+    printf("\n");
+}
+
+// Reads a text trace. Returns false on error.
+static bool readText(FILE* file) {
+    char line[128];
+    for (int lineNumber = 1; fgets(line, sizeof(line), file); lineNumber++) {
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') {
+            continue;
+        }
+
+        unsigned long time;
+        int sensor;
+        char echo[32];
+        if (sscanf(line, "%lu %d %31s", &time, &sensor, echo) != 3) {
+            fprintf(stderr, "Line %d: expected time, sensor and echo\n", lineNumber);
+            return false;
+        }
+        if (sensor < 0 || sensor >= DISTANCE_SENSOR_COUNT) {
+            fprintf(stderr, "Line %d: no sensor %d\n", lineNumber, sensor);
+            return false;
+        }
+
+        TraceEntry entry = { (uint32_t)time, (uint8_t)sensor, {} };
+        if (strcmp(echo, "out-of-range") == 0) {
+            entry.echo.status = DISTANCE_OUT_OF_RANGE;
+        }
+        else if (strcmp(echo, "fault") == 0) {
+            entry.echo.status = DISTANCE_SENSOR_FAULT;
+        }
+        else {
+            char* end;
+            unsigned long length = strtoul(echo, &end, 10);
+            if (*end != '\0' || length > 0xffff) {
+                fprintf(stderr, "Line %d: bad echo %s\n", lineNumber, echo);
+                return false;
+            }
+            entry.echo.status = DISTANCE_VALID;
+            entry.echo.length = length;
+        }
+
+        if (!trace.empty() && entry.time < trace.back().time) {
+            fprintf(stderr, "Line %d: time goes backwards\n", lineNumber);
+            return false;
+        }
+        trace.push_back(entry);
+    }
+    return true;
+}
+
+// Reads a memory dump of echoTrace. Layout follows struct EchoTrace in
+// EchoTrace.h, with little endian 16 bit fields and no padding. Returns false
+// on error.
+static bool readDump(FILE* file) {
+    const size_t ENTRY_SIZE = 6;
+    const size_t SIZE = ECHO_TRACE_LENGTH * ENTRY_SIZE + 3;
+
+    uint8_t dump[SIZE + 1];
+    size_t size = fread(dump, 1, sizeof(dump), file);
+    if (size != SIZE) {
+        fprintf(stderr, "Dump is %zu bytes, expected %zu\n", size, SIZE);
+        return false;
+    }
+
+    uint8_t next = dump[ECHO_TRACE_LENGTH * ENTRY_SIZE];
+    bool isWrapped = dump[ECHO_TRACE_LENGTH * ENTRY_SIZE + 1];
+    uint8_t count = isWrapped ? ECHO_TRACE_LENGTH : next;
+    uint8_t first = isWrapped ? next : 0;
+
+    // Scheduler time wraps around, so times are accumulated from differences
+    uint32_t time = 0;
+    uint16_t previousTime = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        const uint8_t* bytes =
+            dump + ((first + i) % ECHO_TRACE_LENGTH) * ENTRY_SIZE;
+        uint16_t entryTime = bytes[0] | bytes[1] << 8;
+        uint16_t delay = bytes[2] | bytes[3] << 8;
+        uint8_t sensor = bytes[4];
+        uint8_t status = bytes[5];
+
+        if (i > 0) {
+            time += (uint16_t)(entryTime - previousTime);
+        }
+        previousTime = entryTime;
+
+        if (sensor >= DISTANCE_SENSOR_COUNT || status > DISTANCE_SENSOR_FAULT) {
+            fprintf(stderr, "Entry %d is not a valid ping\n", i);
+            return false;
+        }
+        TraceEntry entry = {
+            time,
+            sensor,
+            {
+                (DistanceStatus)status,
+                (uint16_t)(delay / TIMEBASE_US_TO_TICKS(1))
+            }
+        };
+        trace.push_back(entry);
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    bool isDump = false;
+    unsigned long tail = 5000;
+
+    int option;
+    while ((option = getopt(argc, argv, "abt:")) != -1) {
+        switch (option) {
+            case 'a':
+                isAllFramesPrinted = true;
+                break;
+            case 'b':
+                isDump = true;
+                break;
+            case 't':
+                tail = strtoul(optarg, 0, 10);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-a] [-b] [-t tail] trace\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "Usage: %s [-a] [-b] [-t tail] trace\n", argv[0]);
+        return 1;
+    }
+
+    FILE* file = fopen(argv[optind], isDump ? "rb" : "r");
+    if (!file) {
+        perror(argv[optind]);
+        return 1;
+    }
+    bool isRead = isDump ? readDump(file) : readText(file);
+    fclose(file);
+    if (!isRead) {
+        return 1;
+    }
+    if (trace.empty()) {
+        fprintf(stderr, "Trace is empty\n");
+        return 1;
+    }
+
+    uint64_t duration = (trace.back().time + (uint64_t)tail) * 1000;
+    runSimulation(duration, answerPing, printFrame);
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "Test.h"
+
+#include "AvrUtils.h"
+
+#include <avr/io.h>
+
+TEST(pinSetsAndClearsDataBit) {
+    typedef Pin<B, 3> TestPin;
+
+    PORTB = 0x81;
+    TestPin::set();
+    CHECK_EQUAL(0x89, PORTB);
+    TestPin::clear();
+    CHECK_EQUAL(0x81, PORTB);
+    TestPin::setData(true);
+    CHECK_EQUAL(0x89, PORTB);
+}
+
+TEST(pinReadsInputRegister) {
+    typedef Pin<D, 5> TestPin;
+
+    PIND = BV(5);
+    CHECK(TestPin::getData());
+    PIND = ~BV(5);
+    CHECK(!TestPin::getData());
+}
+
+TEST(pinToggleWritesInputRegister) {
+    Pin<C, 2>::toggle();
+    CHECK_EQUAL(BV(2), PINC);
+}
+
+TEST(pinConfiguresDirectionAndPullup) {
+    typedef Pin<C, 4> TestPin;
+
+    TestPin::setDataDirection(true);
+    CHECK_EQUAL(BV(4), DDRC);
+
+    TestPin::setDataDirection(false);
+    CHECK_EQUAL(0, DDRC);
+    CHECK_EQUAL(BV(4), PORTC);
+
+    TestPin::setDataDirection(false, false);
+    CHECK_EQUAL(0, PORTC);
+}
+
+TEST(runtimePinFunctionsMatchPin) {
+    setDataDirection(D, 6, true);
+    setData(D, 6, true);
+    CHECK_EQUAL(BV(6), DDRD);
+    CHECK_EQUAL(BV(6), PORTD);
+
+    PINB = BV(1);
+    CHECK(getData(B, 1));
+    CHECK(!getData(B, 2));
+}
+
+TEST(pinChangeInterruptIsEnabledFromTable) {
+    enablePinChangeInterrupt(B, 2);
+    CHECK_EQUAL(BV(2), PCMSK0);
+    CHECK_EQUAL(BV(PCIE0), PCICR);
+
+    enablePinChangeInterrupt(D, 7);
+    CHECK_EQUAL(BV(7), PCMSK2);
+    CHECK_EQUAL(BV(PCIE0) | BV(PCIE2), PCICR);
+}
+
+TEST(nonexistentPinChangeInterruptIsIgnored) {
+    enablePinChangeInterrupt(C, 7);
+    enablePinChangeInterrupt(C, 8);
+    CHECK_EQUAL(0, PCMSK1);
+    CHECK_EQUAL(0, PCICR);
+}
+
+TEST(timer1NormalModeUsesOnlyPrescalerBits) {
+    initializeTimer1(PSV_8, NORMAL, TOP_00FF);
+    CHECK_EQUAL(0, TCCR1A);
+    CHECK_EQUAL(BV(CS11), TCCR1B);
+}
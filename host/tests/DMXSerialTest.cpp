@@ -0,0 +1,223 @@
+#include "Test.h"
+
+#include "config.h"
+
+#include "AvrUtils.h"
+#include "DMXSerial.h"
+#include "DmxFrame.h"
+#include "Timebase.h"
+
+#include <avr/io.h>
+
+extern "C" void TIMER1_COMPA_vect();
+extern "C" void USART_TX_vect();
+
+#ifdef DMX_TIMER_BREAK
+TEST(dmxBreakAndMarkAreTimed) {
+    TCNT1 = 1000;
+    DMXSerial.init();
+
+    CHECK(!(PORTD & BV(PD1)));
+    CHECK_EQUAL(0, UCSR0B);
+    CHECK_EQUAL(1000 + TIMEBASE_US_TO_TICKS(DMX_BREAK_LENGTH), OCR1A);
+
+    TIMER1_COMPA_vect();
+    CHECK(PORTD & BV(PD1));
+    CHECK_EQUAL(
+        1000 + TIMEBASE_US_TO_TICKS(DMX_BREAK_LENGTH + DMX_MAB_LENGTH),
+        OCR1A
+    );
+}
+#else
+TEST(dmxBreakIsSentAtLowBaudRate) {
+    DMXSerial.init();
+
+    // Zero byte at 100 kbaud, 8E1, ended by transmit complete
+    CHECK_EQUAL(F_CPU / 16 / 100000 - 1, UBRR0L | UBRR0H << 8);
+    CHECK_EQUAL(BV(TXEN0) | BV(TXCIE0), UCSR0B);
+    CHECK_EQUAL(BV(UPM01) | BV(UCSZ01) | BV(UCSZ00), UCSR0C);
+    CHECK_EQUAL(0, UDR0);
+
+    // Back at dmx speed, 8N2, for the start code
+    USART_TX_vect();
+    CHECK_EQUAL(F_CPU / 16 / 250000 - 1, UBRR0L | UBRR0H << 8);
+    CHECK_EQUAL(BV(TXEN0) | BV(UDRIE0), UCSR0B);
+    CHECK_EQUAL(BV(USBS0) | BV(UCSZ01) | BV(UCSZ00), UCSR0C);
+}
+#endif
+
+TEST(dmxFrameHasStartCodeAndAllChannels) {
+    DMXSerial.init();
+
+    uint8_t slots[DMXSERIAL_MAX + 1];
+    uint16_t count = sendDmxFrame(slots, sizeof(slots));
+
+#ifdef DMX_MINIMAL_FRAME
+    CHECK_EQUAL(2, count);
+#else
+    CHECK_EQUAL((DMXSERIAL_MAX < 32 ? DMXSERIAL_MAX : 32) + 1, count);
+#endif
+    CHECK_EQUAL(0, slots[0]);
+}
+
+TEST(dmxValuesAreSentAfterCommit) {
+    DMXSerial.init();
+    DMXSerial.write(3, 77);
+    DMXSerial.commit();
+
+    // Frame in progress keeps the values it started with
+    uint8_t slots[DMXSERIAL_MAX + 1];
+    sendDmxFrame(slots, sizeof(slots));
+#ifdef DMX_DOUBLE_BUFFER
+    CHECK_EQUAL(0, slots[3]);
+#else
+    CHECK_EQUAL(77, slots[3]);
+#endif
+
+    sendDmxFrame(slots, sizeof(slots));
+    CHECK_EQUAL(77, slots[3]);
+
+    // Committed values are kept in later writes
+    DMXSerial.write(4, 12);
+    DMXSerial.commit();
+    sendDmxFrame(slots, sizeof(slots));
+    sendDmxFrame(slots, sizeof(slots));
+    CHECK_EQUAL(77, slots[3]);
+    CHECK_EQUAL(12, slots[4]);
+}
+
+TEST(dmxWriteOutsideUniverseIsIgnored) {
+    DMXSerial.init();
+    DMXSerial.write(DMXSERIAL_MAX + 1, 99);
+    DMXSerial.commit();
+
+    uint8_t slots[DMXSERIAL_MAX + 2] = { 0 };
+    sendDmxFrame(slots, sizeof(slots));
+    uint16_t count = sendDmxFrame(slots, sizeof(slots));
+    CHECK(count <= DMXSERIAL_MAX + 1);
+    CHECK_EQUAL(0, slots[DMXSERIAL_MAX + 1]);
+}
+
+TEST(dmxCommitDoesNotWaitForTheBreak) {
+    DMXSerial.init();
+    DMXSerial.write(3, 1);
+    DMXSerial.commit();
+
+    // Second commit before the break replaces the first one
+    DMXSerial.write(3, 2);
+    DMXSerial.write(4, 5);
+    DMXSerial.commit();
+#ifdef DMX_DOUBLE_BUFFER
+    CHECK(DMXSerial.isCommitPending());
+#endif
+
+    uint8_t slots[DMXSERIAL_MAX + 1];
+    sendDmxFrame(slots, sizeof(slots));
+    sendDmxFrame(slots, sizeof(slots));
+    CHECK(!DMXSerial.isCommitPending());
+    CHECK_EQUAL(2, slots[3]);
+    CHECK_EQUAL(5, slots[4]);
+
+    // Commit without writes keeps the values
+    DMXSerial.commit();
+    sendDmxFrame(slots, sizeof(slots));
+    sendDmxFrame(slots, sizeof(slots));
+    CHECK_EQUAL(2, slots[3]);
+    CHECK_EQUAL(5, slots[4]);
+}
+
+TEST(dmxRewriteBufferIsNotCopied) {
+    DMXSerial.init();
+    DMXSerial.write(3, 77);
+    DMXSerial.commit();
+
+    uint8_t* buffer = DMXSerial.getRewriteBuffer();
+#ifdef DMX_DOUBLE_BUFFER
+    // Older values, committed value was not copied
+    CHECK_EQUAL(0, buffer[3]);
+#endif
+    buffer[3] = 78;
+    // Later writes keep the rewritten values
+    DMXSerial.write(4, 12);
+    DMXSerial.commit();
+
+    uint8_t slots[DMXSERIAL_MAX + 1];
+    sendDmxFrame(slots, sizeof(slots));
+    sendDmxFrame(slots, sizeof(slots));
+    CHECK_EQUAL(78, slots[3]);
+    CHECK_EQUAL(12, slots[4]);
+}
+
+TEST(dmxWriteRangeIsClampedToUniverse) {
+    DMXSerial.init();
+    const uint8_t high[] = { 1, 2, 3, 4 };
+    DMXSerial.writeRange(DMXSERIAL_MAX - 1, high, 4);
+    const uint8_t low[] = { 5, 6, 7, 8 };
+    DMXSerial.writeRange(-1, low, 4);
+    // Entirely outside the universe
+    DMXSerial.writeRange(DMXSERIAL_MAX + 1, high, 2);
+    DMXSerial.writeRange(-5, low, 3);
+    DMXSerial.commit();
+
+    uint8_t slots[DMXSERIAL_MAX + 2] = { 0 };
+    sendDmxFrame(slots, sizeof(slots));
+    uint16_t count = sendDmxFrame(slots, sizeof(slots));
+    CHECK_EQUAL(DMXSERIAL_MAX + 1, count);
+    CHECK_EQUAL(7, slots[1]);
+    CHECK_EQUAL(8, slots[2]);
+    CHECK_EQUAL(1, slots[DMXSERIAL_MAX - 1]);
+    CHECK_EQUAL(2, slots[DMXSERIAL_MAX]);
+    CHECK_EQUAL(0, slots[DMXSERIAL_MAX + 1]);
+}
+
+// Returns time from the break ending the previous frame to the break ending
+// the next one, in timebase ticks
+static uint16_t framePeriod() {
+    uint8_t slots[DMXSERIAL_MAX + 1];
+    uint16_t start = TCNT1;
+    sendDmxFrame(slots, sizeof(slots));
+    return TCNT1 - start;
+}
+
+TEST(dmxFramesArePaddedToRefreshRate) {
+    DMXSerial.init();
+    framePeriod();
+
+    // Short frames are padded to the shortest legal length
+    DMXSerial.refreshRate(0);
+    framePeriod();
+    CHECK_EQUAL(TIMEBASE_US_TO_TICKS(1204), framePeriod());
+
+    DMXSerial.refreshRate(50);
+    framePeriod();
+    CHECK_EQUAL(TIMEBASE_TICKS_PER_SECOND / 50, framePeriod());
+    CHECK_EQUAL(TIMEBASE_TICKS_PER_SECOND / 50, framePeriod());
+
+    // Gap longer than the timer period is split into several compare matches
+    DMXSerial.refreshRate(10);
+    framePeriod();
+    CHECK_EQUAL(
+        (uint16_t)(TIMEBASE_TICKS_PER_SECOND / 10),
+        framePeriod()
+    );
+}
+
+TEST(dmxFramesPerSecondCountsFramesInOneSecond) {
+    DMXSerial.init();
+    DMXSerial.refreshRate(100);
+
+    // Frames are counted at the break ending them
+    for (uint8_t i = 0; i < 100; i++) {
+        framePeriod();
+    }
+    CHECK_EQUAL(100, DMXSerial.framesPerSecond());
+
+    // Count is updated once per second
+    DMXSerial.refreshRate(50);
+    for (uint8_t i = 0; i < 49; i++) {
+        framePeriod();
+    }
+    CHECK_EQUAL(100, DMXSerial.framesPerSecond());
+    framePeriod();
+    CHECK_EQUAL(50, DMXSerial.framesPerSecond());
+}
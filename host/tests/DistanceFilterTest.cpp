@@ -0,0 +1,68 @@
+#include "Test.h"
+
+#include "DistanceFilter.h"
+
+TEST(filterStartsFromFirstSample) {
+    DistanceFilter filter;
+
+    CHECK_EQUAL(0, filter.get());
+    CHECK_EQUAL(1500, filter.add(1500));
+    CHECK_EQUAL(1500, filter.get());
+}
+
+TEST(filterRemovesSingleSpike) {
+    DistanceFilter filter;
+
+    filter.add(1500);
+    filter.add(1500);
+    // Within outlier limit, but removed by the median
+    filter.add(2400);
+    CHECK_EQUAL(1500, filter.add(1500));
+}
+
+TEST(filterRejectsOutliersUntilTheyPersist) {
+    DistanceFilter filter;
+
+    filter.add(1000);
+    CHECK_EQUAL(1000, filter.add(3000));
+    CHECK_EQUAL(1000, filter.add(3000));
+    CHECK_EQUAL(DISTANCE_FILTER_OUTLIER_COUNT, filter.getRejectedCount());
+
+    // Persistent change is accepted and the output converges to it
+    for (uint8_t i = 0; i < 20; i++) {
+        filter.add(3000);
+    }
+    CHECK_EQUAL(3000, filter.get());
+}
+
+TEST(filterStartsOverAfterReset) {
+    DistanceFilter filter;
+
+    filter.add(1000);
+    filter.reset();
+    CHECK_EQUAL(0, filter.get());
+
+    // Not an outlier of the forgotten sample
+    CHECK_EQUAL(3000, filter.add(3000));
+    CHECK_EQUAL(0, filter.getRejectedCount());
+}
+
+TEST(filterResetsAfterMissesInARow) {
+    DistanceFilter filter;
+
+    filter.add(1000);
+    for (uint8_t i = 0; i < DISTANCE_FILTER_RESET_COUNT - 1; i++) {
+        filter.addMiss();
+    }
+    CHECK_EQUAL(1000, filter.get());
+
+    // Target seen again, misses start over
+    filter.add(1000);
+    for (uint8_t i = 0; i < DISTANCE_FILTER_RESET_COUNT - 1; i++) {
+        filter.addMiss();
+    }
+    CHECK_EQUAL(1000, filter.get());
+
+    filter.addMiss();
+    CHECK_EQUAL(0, filter.get());
+}
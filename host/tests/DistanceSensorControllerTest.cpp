@@ -0,0 +1,290 @@
+#include "Test.h"
+
+#include "config.h"
+
+#include "AvrUtils.h"
+#include "DistanceFilter.h"
+#include "DistanceSensorController.h"
+#include "Timebase.h"
+
+#include <avr/io.h>
+
+extern "C" void PCINT1_vect();
+extern "C" void TIMER1_COMPB_vect();
+
+static_assert(
+    DISTANCE_SENSOR_COUNT == 1
+        && DISTANCE_SENSOR_TRIGGER_PORT == C
+        && DISTANCE_SENSOR_ECHO_PORT == C,
+    "Tests assume a single sensor in port C"
+);
+
+static const uint8_t TRIGGER_PINS[] = DISTANCE_SENSOR_TRIGGER_PINS;
+static const uint8_t ECHO_PINS[] = DISTANCE_SENSOR_ECHO_PINS;
+
+// Removes measurements left by earlier tests
+static void drain(DistanceSensorController& controller) {
+    DistanceMeasurement measurement;
+    while (controller.read(measurement)) {
+    }
+}
+
+// Advances the timer to the next compare match and runs the interrupt
+static void compareMatch() {
+    TCNT1 = OCR1B;
+    TIMER1_COMPB_vect();
+}
+
+static void echoEdge(uint16_t time, bool isHigh) {
+    TCNT1 = time;
+    if (isHigh) {
+        PINC |= BV(ECHO_PINS[0]);
+    }
+    else {
+        PINC &= ~BV(ECHO_PINS[0]);
+    }
+    PCINT1_vect();
+}
+
+// Runs a ping started by the previous compare match, up to the trigger of the
+// next one. Echo length is given in millimeter, or 0 for no target in range.
+static void ping(uint16_t distance) {
+    compareMatch();
+    uint16_t start = TCNT1 + 100;
+    echoEdge(start, true);
+    if (distance > 0) {
+        echoEdge(
+            start + TIMEBASE_US_TO_TICKS(
+                (uint32_t)distance * 1000 / DISTANCE_SENSOR_MM_PER_MS
+            ),
+            false
+        );
+    }
+    else {
+        // Echo times out and ends during recovery
+        compareMatch();
+        echoEdge(TCNT1 + 100, false);
+    }
+    compareMatch();
+}
+
+// Passes queued measurements to a filter like the main program does. Returns
+// the filtered distance, or 0xffff if the latest ping found no target.
+static uint16_t filterMeasurements(
+    DistanceSensorController& controller,
+    DistanceFilter& filter
+) {
+    uint16_t distance = 0xffff;
+    DistanceMeasurement measurement;
+    while (controller.read(measurement)) {
+        if (measurement.status == DISTANCE_VALID) {
+            distance = filter.add(measurement.distance);
+        }
+        else {
+            distance = 0xffff;
+            filter.addMiss();
+        }
+    }
+    return distance;
+}
+
+TEST(triggerPulseIsTimedByCompare) {
+    DistanceSensorController controller;
+    drain(controller);
+
+    TCNT1 = 500;
+    controller.start();
+    CHECK(PORTC & BV(TRIGGER_PINS[0]));
+    CHECK(TIMSK1 & BV(OCIE1B));
+    CHECK_EQUAL(
+        500 + TIMEBASE_US_TO_TICKS(DISTANCE_SENSOR_TRIGGER_LENGTH),
+        OCR1B
+    );
+
+    compareMatch();
+    CHECK(!(PORTC & BV(TRIGGER_PINS[0])));
+}
+
+TEST(echoIsConvertedToDistance) {
+    DistanceSensorController controller;
+    drain(controller);
+
+    TCNT1 = 0;
+    controller.start();
+    compareMatch();
+
+    // 1000 ticks is 500 us
+    echoEdge(1000, true);
+    echoEdge(2000, false);
+
+    DistanceMeasurement measurement;
+    CHECK(controller.read(measurement));
+    CHECK_EQUAL(DISTANCE_VALID, measurement.status);
+    CHECK_EQUAL(0, measurement.sensor);
+    CHECK_EQUAL(2000, measurement.timestamp);
+    // Conversion is truncating fixed point, allow one millimeter error
+    CHECK(measurement.distance <= DISTANCE_SENSOR_MM_PER_MS / 2);
+    CHECK(measurement.distance >= DISTANCE_SENSOR_MM_PER_MS / 2 - 1);
+    CHECK(!controller.read(measurement));
+
+    // Next ping after recovery
+    CHECK_EQUAL(
+        (uint16_t)(2000 + TIMEBASE_US_TO_TICKS(DISTANCE_SENSOR_PING_RECOVERY)),
+        OCR1B
+    );
+    compareMatch();
+    CHECK(PORTC & BV(TRIGGER_PINS[0]));
+}
+
+TEST(echoAcrossTimerWrapAroundIsMeasured) {
+    DistanceSensorController controller;
+    drain(controller);
+
+    TCNT1 = 0xf000;
+    controller.start();
+    compareMatch();
+    echoEdge(0xff00, true);
+    echoEdge(0x02e8, false);
+
+    DistanceMeasurement measurement;
+    CHECK(controller.read(measurement));
+    CHECK_EQUAL(DISTANCE_VALID, measurement.status);
+    // Conversion is truncating fixed point, allow one millimeter error
+    CHECK(measurement.distance <= DISTANCE_SENSOR_MM_PER_MS / 2);
+    CHECK(measurement.distance >= DISTANCE_SENSOR_MM_PER_MS / 2 - 1);
+}
+
+TEST(missingEchoIsSensorFault) {
+    DistanceSensorController controller;
+    drain(controller);
+
+    controller.start();
+    compareMatch();
+    compareMatch();
+
+    DistanceMeasurement first;
+    CHECK(controller.read(first));
+    CHECK_EQUAL(DISTANCE_SENSOR_FAULT, first.status);
+
+    // Pinging continues, with a new sequence number
+    compareMatch();
+    compareMatch();
+    echoEdge(TCNT1 + 100, true);
+    compareMatch();
+
+    DistanceMeasurement second;
+    CHECK(controller.read(second));
+    CHECK_EQUAL(DISTANCE_OUT_OF_RANGE, second.status);
+    CHECK_EQUAL((uint8_t)(first.sequence + 1), second.sequence);
+}
+
+TEST(stuckEchoSkipsTrigger) {
+    DistanceSensorController controller;
+    drain(controller);
+
+    PINC |= BV(ECHO_PINS[0]);
+    controller.start();
+
+    // Ping is deferred in 1 ms steps until the stuck echo time has passed
+    DistanceMeasurement measurement;
+    for (uint16_t i = 0; i < DISTANCE_SENSOR_STUCK_ECHO_TIME / 1000; i++) {
+        CHECK(!controller.read(measurement));
+        compareMatch();
+    }
+    CHECK(!(PORTC & BV(TRIGGER_PINS[0])));
+
+    CHECK(controller.read(measurement));
+    CHECK_EQUAL(DISTANCE_SENSOR_FAULT, measurement.status);
+    PINC &= ~BV(ECHO_PINS[0]);
+}
+
+TEST(echoHeldAfterTimeoutDefersNextPing) {
+    DistanceSensorController controller;
+    drain(controller);
+
+    // Echo starts, but no target is in range
+    controller.start();
+    compareMatch();
+    uint16_t start = TCNT1 + 1000;
+    echoEdge(start, true);
+    compareMatch();
+    DistanceMeasurement measurement;
+    CHECK(controller.read(measurement));
+    CHECK_EQUAL(DISTANCE_OUT_OF_RANGE, measurement.status);
+
+    // Sensor holds the echo past the ping recovery
+    compareMatch();
+    CHECK(!(PORTC & BV(TRIGGER_PINS[0])));
+    compareMatch();
+    CHECK(!(PORTC & BV(TRIGGER_PINS[0])));
+
+    // Next ping starts at the first deferral step after the echo ends
+    echoEdge(TCNT1 + 100, false);
+    compareMatch();
+    CHECK(PORTC & BV(TRIGGER_PINS[0]));
+    CHECK(!controller.read(measurement));
+}
+
+TEST(longRecoveryIsSplitIntoSteps) {
+    DistanceSensorController controller;
+    drain(controller);
+
+    controller.setPingRecovery(100000);
+    TCNT1 = 0;
+    controller.start();
+    compareMatch();
+    compareMatch();
+
+    // 100 ms is 200000 ticks, which takes seven compare steps
+    uint8_t steps = 0;
+    while (!(PORTC & BV(TRIGGER_PINS[0])) && steps < 20) {
+        compareMatch();
+        steps++;
+    }
+    CHECK_EQUAL(7, steps);
+
+    controller.setPingRecovery(DISTANCE_SENSOR_PING_RECOVERY);
+}
+
+TEST(filterTakesNewTargetAfterEchoesAreLost) {
+    DistanceSensorController controller;
+    DistanceFilter distanceFilter;
+    drain(controller);
+
+    PINC &= ~BV(ECHO_PINS[0]);
+    TCNT1 = 0;
+    controller.start();
+
+    // Stray echo, then nothing in range for a moment
+    ping(1000);
+    uint16_t stray = filterMeasurements(controller, distanceFilter);
+    CHECK(stray >= 999 && stray <= 1000);
+    for (uint8_t i = 0; i < DISTANCE_FILTER_RESET_COUNT; i++) {
+        ping(0);
+    }
+    CHECK_EQUAL(0xffff, filterMeasurements(controller, distanceFilter));
+
+    // Farther target is taken as is, not rejected as outlier of the stray
+    ping(3000);
+    uint16_t target = filterMeasurements(controller, distanceFilter);
+    CHECK(target >= 2999 && target <= 3000);
+    CHECK_EQUAL(0, distanceFilter.getRejectedCount());
+}
+
+TEST(filterKeepsTargetOverSingleLostEcho) {
+    DistanceSensorController controller;
+    DistanceFilter distanceFilter;
+    drain(controller);
+
+    PINC &= ~BV(ECHO_PINS[0]);
+    TCNT1 = 0;
+    controller.start();
+
+    ping(1000);
+    ping(0);
+    // Spike right after the lost echo is still rejected
+    ping(3000);
+    uint16_t target = filterMeasurements(controller, distanceFilter);
+    CHECK(target >= 999 && target <= 1000);
+    CHECK_EQUAL(1, distanceFilter.getRejectedCount());
+}
@@ -0,0 +1,32 @@
+#include "Test.h"
+
+#include "config.h"
+
+#include "FastRandom.h"
+
+TEST(randomIsRepeatable) {
+    FastRandom first(1234);
+    FastRandom second(1234);
+
+    for (uint8_t i = 0; i < 100; i++) {
+        CHECK_EQUAL(first.next(), second.next());
+    }
+}
+
+TEST(randomBelowIsInRangeAndCoversIt) {
+    FastRandom random(FLICKER_RANDOM_SEED);
+    uint16_t counts[10] = { 0 };
+
+    for (uint16_t i = 0; i < 10000; i++) {
+        uint8_t value = random.below(10);
+        CHECK(value < 10);
+        if (value < 10) {
+            counts[value]++;
+        }
+    }
+
+    // Each value within 10 % of uniform
+    for (uint8_t i = 0; i < 10; i++) {
+        CHECK(counts[i] > 900 && counts[i] < 1100);
+    }
+}
@@ -0,0 +1,145 @@
+#include "Test.h"
+
+#include "config.h"
+
+#include "DMXSerial.h"
+#include "DmxFrame.h"
+#include "FixtureProfile.h"
+#include "FlickeringDmxController.h"
+#include "GammaTable.h"
+
+#include <avr/pgmspace.h>
+
+// Sends frames until committed values are on the bus
+static void sendCommitted(uint8_t* slots, uint16_t size) {
+    sendDmxFrame(slots, size);
+    sendDmxFrame(slots, size);
+}
+
+TEST(gammaTableIsMonotonicFromZeroToFull) {
+    CHECK_EQUAL(0, pgm_read_word(&GAMMA_TABLE[0]));
+    CHECK_EQUAL(0xffff, pgm_read_word(&GAMMA_TABLE[GAMMA_LENGTH - 1]));
+    for (uint16_t i = 1; i < GAMMA_LENGTH; i++) {
+        CHECK(pgm_read_word(&GAMMA_TABLE[i - 1]) <= pgm_read_word(&GAMMA_TABLE[i]));
+    }
+}
+
+TEST(fixedChannelsAndBaselineAreSent) {
+    FlickeringDmxController dmx;
+    CHECK(dmx.addFixture(TEST_FIXTURE_PROFILE, 1, 200, 0, WAVEFORM_NOISE));
+    dmx.run();
+
+    uint8_t slots[DMXSERIAL_MAX + 1];
+    sendCommitted(slots, sizeof(slots));
+
+#ifdef GAMMA_CORRECTION
+    CHECK_EQUAL(pgm_read_word(&GAMMA_TABLE[200]) >> 8, slots[1]);
+#else
+    CHECK_EQUAL(200, slots[1]);
+#endif
+    CHECK_EQUAL(255, slots[5]);
+}
+
+TEST(sixteenBitFixtureGetsCoarseAndFine) {
+    FlickeringDmxController dmx;
+    CHECK(dmx.addFixture(DIMMER_16BIT_PROFILE, 2, 100, 0, WAVEFORM_NOISE));
+    dmx.run();
+
+    uint8_t slots[DMXSERIAL_MAX + 1];
+    sendCommitted(slots, sizeof(slots));
+
+#ifdef GAMMA_CORRECTION
+    uint16_t level = pgm_read_word(&GAMMA_TABLE[100]);
+#else
+    uint16_t level = 100 << 8 | 100;
+#endif
+    CHECK_EQUAL(level >> 8, slots[2]);
+    CHECK_EQUAL(level & 0xff, slots[3]);
+}
+
+TEST(fixtureOutsideUniverseIsRejected) {
+    FlickeringDmxController dmx;
+    CHECK(!dmx.addFixture(DIMMER_PROFILE, DMXSERIAL_MAX + 1, 100, 0, WAVEFORM_NOISE));
+    CHECK(!dmx.addFixture(DIMMER_16BIT_PROFILE, DMXSERIAL_MAX, 100, 0, WAVEFORM_NOISE));
+}
+
+TEST(flickerStaysWithinIntensity) {
+    FlickeringDmxController dmx;
+    dmx.addFixture(DIMMER_PROFILE, 1, 128, 60, WAVEFORM_CANDLE);
+    dmx.setFlickerEnabled(true);
+
+    uint8_t slots[DMXSERIAL_MAX + 1];
+    uint8_t low = 0xff;
+    uint8_t high = 0;
+    for (uint16_t i = 0; i < 500; i++) {
+        dmx.run();
+        sendDmxFrame(slots, sizeof(slots));
+        if (i == 0) {
+            // First frame still has the zero written by addFixture()
+            continue;
+        }
+        if (slots[1] < low) {
+            low = slots[1];
+        }
+        if (slots[1] > high) {
+            high = slots[1];
+        }
+    }
+
+#ifdef GAMMA_CORRECTION
+    CHECK(low >= pgm_read_word(&GAMMA_TABLE[128 - 30]) >> 8);
+    CHECK(high <= pgm_read_word(&GAMMA_TABLE[128 + 30]) >> 8);
+#else
+    CHECK(low >= 128 - 30);
+    CHECK(high <= 128 + 30);
+#endif
+    // Flicker is actually visible
+    CHECK(high > low);
+}
+
+TEST(fadeTimeDoesNotDependOnFrameRate) {
+    FlickeringDmxController dmx;
+    dmx.addFixture(DIMMER_PROFILE, 1, 128, 60, WAVEFORM_CANDLE);
+    dmx.setFlickerEnabled(true);
+
+    uint8_t slots[DMXSERIAL_MAX + 1];
+    for (uint16_t i = 0; i < FLICKER_FADE_IN_TIME / EFFECT_PERIOD + 1; i++) {
+        dmx.run();
+        sendDmxFrame(slots, sizeof(slots));
+    }
+
+    // Frame only on every fourth step, like at a low refresh rate
+    dmx.setFlickerEnabled(false);
+    for (uint16_t i = 0; i < FLICKER_FADE_OUT_TIME / EFFECT_PERIOD + 1; i++) {
+        dmx.run();
+        if (i % 4 == 0) {
+            sendDmxFrame(slots, sizeof(slots));
+        }
+    }
+
+    // Fade has ended, so the output is the baseline
+    sendCommitted(slots, sizeof(slots));
+    dmx.run();
+    sendCommitted(slots, sizeof(slots));
+#ifdef GAMMA_CORRECTION
+    CHECK_EQUAL(pgm_read_word(&GAMMA_TABLE[128]) >> 8, slots[1]);
+#else
+    CHECK_EQUAL(128, slots[1]);
+#endif
+}
+
+TEST(fixedChannelsStayInEveryFrame) {
+    FlickeringDmxController dmx;
+    dmx.addFixture(TEST_FIXTURE_PROFILE, 1, 200, 60, WAVEFORM_CANDLE);
+    dmx.setFlickerEnabled(true);
+
+    // Runs go through all dmx buffers
+    uint8_t slots[DMXSERIAL_MAX + 1];
+    dmx.run();
+    sendCommitted(slots, sizeof(slots));
+    for (uint8_t i = 0; i < 10; i++) {
+        dmx.run();
+        sendDmxFrame(slots, sizeof(slots));
+        CHECK_EQUAL(255, slots[5]);
+    }
+}
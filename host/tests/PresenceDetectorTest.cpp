@@ -0,0 +1,41 @@
+#include "Test.h"
+
+#include "PresenceDetector.h"
+
+TEST(presenceStartsAfterEnterDwell) {
+    PresenceDetector detector(1000, 1500, 100, 1000);
+
+    CHECK(!detector.update(800, 0));
+    CHECK(!detector.update(800, 99));
+    CHECK(detector.update(800, 100));
+    CHECK(detector.isPresent());
+}
+
+TEST(presenceIgnoresShortExcursions) {
+    PresenceDetector detector(1000, 1500, 100, 1000);
+
+    detector.update(800, 0);
+    detector.update(1200, 50);
+    CHECK(!detector.update(800, 120));
+    CHECK(detector.update(800, 220));
+}
+
+TEST(presenceUsesExitThresholdAndDwell) {
+    PresenceDetector detector(1000, 1500, 100, 1000);
+
+    detector.update(800, 0);
+    detector.update(800, 100);
+
+    // Between thresholds, presence is kept
+    CHECK(detector.update(1200, 2000));
+    CHECK(detector.update(1600, 3000));
+    CHECK(detector.update(1600, 3999));
+    CHECK(!detector.update(1600, 4000));
+}
+
+TEST(presenceDwellHandlesTimeWrapAround) {
+    PresenceDetector detector(1000, 1500, 100, 1000);
+
+    CHECK(!detector.update(800, 0xffc0));
+    CHECK(detector.update(800, 0x0024));
+}
@@ -0,0 +1,48 @@
+#include "Test.h"
+
+#include "RingBuffer.h"
+
+TEST(ringBufferKeepsOrder) {
+    RingBuffer<uint8_t, 4> buffer;
+    uint8_t item;
+
+    CHECK(!buffer.pop(item));
+    for (uint8_t i = 1; i <= 3; i++) {
+        CHECK(buffer.push(i));
+    }
+    for (uint8_t i = 1; i <= 3; i++) {
+        CHECK(buffer.pop(item));
+        CHECK_EQUAL(i, item);
+    }
+    CHECK(!buffer.pop(item));
+}
+
+TEST(ringBufferWrapsAround) {
+    RingBuffer<uint16_t, 2> buffer;
+    uint16_t item;
+
+    for (uint16_t i = 0; i < 1000; i++) {
+        CHECK(buffer.push(i));
+        CHECK(buffer.pop(item));
+        CHECK_EQUAL(i, item);
+    }
+}
+
+TEST(ringBufferCountsDropsAndOverflows) {
+    RingBuffer<uint8_t, 2> buffer;
+    uint8_t item;
+
+    buffer.push(1);
+    buffer.push(2);
+    CHECK(!buffer.push(3));
+    CHECK(!buffer.push(4));
+    CHECK_EQUAL(2, buffer.getDroppedCount());
+    CHECK_EQUAL(1, buffer.getOverflowCount());
+
+    buffer.pop(item);
+    CHECK_EQUAL(1, item);
+    buffer.push(5);
+    CHECK(!buffer.push(6));
+    CHECK_EQUAL(3, buffer.getDroppedCount());
+    CHECK_EQUAL(2, buffer.getOverflowCount());
+}
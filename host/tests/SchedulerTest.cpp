@@ -0,0 +1,169 @@
+#include "Test.h"
+
+#include "config.h"
+
+#include "Scheduler.h"
+#include "Timebase.h"
+
+#include <avr/io.h>
+#include <avr/sleep.h>
+
+#include <setjmp.h>
+
+extern "C" void TIMER0_COMPA_vect();
+
+// Timebase ticks per scheduler tick
+#define TICK_TIMEBASE_TICKS TIMEBASE_US_TO_TICKS(1000)
+
+// Ends Scheduler::run(), which does not return otherwise
+static jmp_buf finished;
+// Tick at which the scheduler is stopped
+static uint16_t endTicks;
+// Task triggered from the sleep hook, or -1
+static int8_t triggerTask;
+// Ticks left until triggerTask is triggered
+static uint16_t ticksUntilTrigger;
+
+// Ticks at which the task under test was run, relative to the start
+static uint16_t runTicks[16];
+static uint8_t runCount;
+static uint16_t startTicks;
+// Time spent by each run of the task under test, in microseconds
+static uint32_t runLength;
+
+// Lets time pass and runs the interrupts while the scheduler sleeps
+static void sleep() {
+    if ((int16_t)(Scheduler::getTicks() - endTicks) >= 0) {
+        longjmp(finished, 1);
+    }
+
+    TCNT1 += TICK_TIMEBASE_TICKS;
+    TIMER0_COMPA_vect();
+
+    if (triggerTask >= 0 && --ticksUntilTrigger == 0) {
+        Scheduler::trigger(triggerTask);
+        triggerTask = -1;
+    }
+}
+
+// Runs the scheduler until a number of ticks has passed since reset()
+static void runFor(Scheduler& scheduler, uint16_t ticks) {
+    endTicks = startTicks + ticks;
+    hostSleepHook = sleep;
+    if (setjmp(finished) == 0) {
+        scheduler.run();
+    }
+    hostSleepHook = 0;
+}
+
+// Task under test. Spends runLength microseconds, with scheduler ticks
+// happening as time passes.
+static void task() {
+    if (runCount < sizeof(runTicks) / sizeof(runTicks[0])) {
+        runTicks[runCount] = Scheduler::getTicks() - startTicks;
+    }
+    runCount++;
+
+    uint32_t remaining = runLength;
+    for (; remaining >= 1000; remaining -= 1000) {
+        TCNT1 += TICK_TIMEBASE_TICKS;
+        TIMER0_COMPA_vect();
+    }
+    TCNT1 += TIMEBASE_US_TO_TICKS(remaining);
+}
+
+// Starts a test with a new scheduler
+static void reset(uint32_t length) {
+    runCount = 0;
+    runLength = length;
+    triggerTask = -1;
+    startTicks = Scheduler::getTicks();
+}
+
+TEST(taskIsReleasedEveryPeriod) {
+    Scheduler scheduler;
+    reset(500);
+    int8_t index = scheduler.addTask(task, 5, 1);
+
+    runFor(scheduler, 20);
+    CHECK_EQUAL(5, runCount);
+    for (uint8_t i = 0; i < 5; i++) {
+        CHECK_EQUAL(i * 5, runTicks[i]);
+    }
+    CHECK_EQUAL(0, scheduler.getOverrunCount(index));
+}
+
+TEST(runOverBudgetIsOverrun) {
+    Scheduler scheduler;
+    reset(2500);
+    int8_t index = scheduler.addTask(task, 10, 2);
+
+    runFor(scheduler, 20);
+    CHECK_EQUAL(3, runCount);
+    CHECK_EQUAL(3, scheduler.getOverrunCount(index));
+    // Releases keep their phase
+    CHECK_EQUAL(10, runTicks[1]);
+    CHECK_EQUAL(20, runTicks[2]);
+}
+
+TEST(runOverPeriodSkipsReleases) {
+    Scheduler scheduler;
+    reset(7500);
+    int8_t index = scheduler.addTask(task, 5, 30);
+
+    runFor(scheduler, 20);
+    CHECK_EQUAL(3, runCount);
+    CHECK_EQUAL(10, runTicks[1]);
+    CHECK_EQUAL(20, runTicks[2]);
+    CHECK_EQUAL(3, scheduler.getOverrunCount(index));
+}
+
+TEST(largeBudgetIsLimited) {
+    Scheduler scheduler;
+    reset(31000);
+    int8_t index = scheduler.addTask(task, 100, 1000);
+
+    runFor(scheduler, 50);
+    CHECK_EQUAL(1, runCount);
+    CHECK_EQUAL(1, scheduler.getOverrunCount(index));
+}
+
+TEST(runOverTimebasePeriodIsOverrun) {
+    Scheduler scheduler;
+    // Timebase wraps around after 32.8 ms, so that the timebase difference
+    // over this run is only 0.2 ms
+    reset(33000);
+    int8_t index = scheduler.addTask(task, 100, 30);
+
+    runFor(scheduler, 50);
+    CHECK_EQUAL(1, runCount);
+    CHECK_EQUAL(1, scheduler.getOverrunCount(index));
+}
+
+TEST(triggeredTaskRunsAtOnce) {
+    Scheduler scheduler;
+    reset(500);
+    int8_t index = scheduler.addTask(task, 100, 1);
+    triggerTask = index;
+    ticksUntilTrigger = 30;
+
+    runFor(scheduler, 150);
+    CHECK_EQUAL(3, runCount);
+    CHECK_EQUAL(0, runTicks[0]);
+    CHECK_EQUAL(30, runTicks[1]);
+    // Periodic releases continue from the triggered run
+    CHECK_EQUAL(130, runTicks[2]);
+    CHECK_EQUAL(0, scheduler.getOverrunCount(index));
+}
+
+TEST(triggerOutsideTaskTableIsIgnored) {
+    Scheduler scheduler;
+    reset(500);
+    int8_t index = scheduler.addTask(task, 100, 1);
+    Scheduler::trigger(-1);
+    Scheduler::trigger(SCHEDULER_MAX_TASKS);
+
+    runFor(scheduler, 50);
+    CHECK_EQUAL(1, runCount);
+    CHECK_EQUAL(0, scheduler.getOverrunCount(index));
+}
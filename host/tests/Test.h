@@ -0,0 +1,77 @@
+// Minimal test harness for the host build. Tests are functions defined with
+// TEST(), which registers them at static initialization. Checks record
+// failures and let the test continue, so one run reports every failing check.
+
+#ifndef _H_TEST
+#define _H_TEST
+
+#include <stdint.h>
+
+/// Function containing a test
+typedef void (*TestFunction)();
+
+/// \struct TestCase
+///
+/// Registered test. Test cases form a linked list in registration order.
+struct TestCase {
+    /// Test name
+    const char* name;
+    /// Test body
+    TestFunction function;
+    /// Next registered test
+    TestCase* next;
+
+    /// \brief
+    ///    Registers a test.
+    TestCase(const char* name, TestFunction function);
+};
+
+/// \brief
+///    Records result of a check.
+///
+/// \param isPassed
+///    If the check passed
+/// \param file
+///    Source file of the check
+/// \param line
+///    Source line of the check
+/// \param expression
+///    Checked expression
+void testCheck(
+    bool isPassed,
+    const char* file,
+    int line,
+    const char* expression
+);
+
+/// \brief
+///    Records result of an equality check, printing both values on failure.
+void testCheckEqual(
+    long expected,
+    long actual,
+    const char* file,
+    int line,
+    const char* expression
+);
+
+/// Defines and registers a test.
+#define TEST(name) \
+    static void name(); \
+    static TestCase name##Case(#name, name); \
+    static void name()
+
+/// Checks that a condition holds.
+#define CHECK(condition) \
+    testCheck((condition), __FILE__, __LINE__, #condition)
+
+/// Checks that two integer values are equal.
+#define CHECK_EQUAL(expected, actual) \
+    testCheckEqual( \
+        (long)(expected), \
+        (long)(actual), \
+        __FILE__, \
+        __LINE__, \
+        #actual \
+    )
+
+#endif
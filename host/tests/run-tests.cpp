@@ -0,0 +1,79 @@
+// Runs all registered tests. Io registers are cleared and interrupts enabled
+// before each test. Exit status is nonzero if any check failed.
+
+#include "Test.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <stdio.h>
+
+static TestCase* firstTest = 0;
+static TestCase* lastTest = 0;
+
+static int checkCount = 0;
+static int failureCount = 0;
+
+TestCase::TestCase(const char* name, TestFunction function) :
+    name(name),
+    function(function),
+    next(0) {
+    if (lastTest) {
+        lastTest->next = this;
+    }
+    else {
+        firstTest = this;
+    }
+    lastTest = this;
+}
+
+void testCheck(
+    bool isPassed,
+    const char* file,
+    int line,
+    const char* expression
+) {
+    checkCount++;
+    if (!isPassed) {
+        failureCount++;
+        printf("%s:%d: check failed: %s\n", file, line, expression);
+    }
+}
+
+void testCheckEqual(
+    long expected,
+    long actual,
+    const char* file,
+    int line,
+    const char* expression
+) {
+    checkCount++;
+    if (expected != actual) {
+        failureCount++;
+        printf(
+            "%s:%d: check failed: %s is %ld, expected %ld\n",
+            file,
+            line,
+            expression,
+            actual,
+            expected
+        );
+    }
+}
+
+int main() {
+    int testCount = 0;
+    for (TestCase* test = firstTest; test; test = test->next) {
+        resetHostRegisters();
+        sei();
+        test->function();
+        testCount++;
+    }
+
+    printf(
+        "%d tests, %d checks, %d failures\n",
+        testCount,
+        checkCount,
+        failureCount
+    );
+    return failureCount ? 1 : 0;
+}
@@ -109,112 +109,28 @@ void setDataDirection(Port port, int pin, bool enable, bool enablePullup) {
     }
 }
 
+// Pin change mask registers and interrupt enable bits, indexed by port. Pins
+// in port B are mapped to Pin Change Interrupt 0, port C to 1 and port D to 2.
+static volatile uint8_t* const PIN_CHANGE_MASKS[] = {
+    &PCMSK0,
+    &PCMSK1,
+    &PCMSK2
+};
+static const uint8_t PIN_CHANGE_ENABLE_BITS[] = { PCIE0, PCIE1, PCIE2 };
+
 void enablePinChangeInterrupt(Port port, int pin) {
-    switch (port) {
-        case B:
-            // Pins in port B are mapped to Pin Change Interrupt 0
-            PCICR |= (1 << PCIE0);
-            switch (pin) {
-                case 0:
-                    PCMSK0 |= (1 << PCINT0);
-                    break;
-                case 1:
-                    PCMSK0 |= (1 << PCINT1);
-                    break;
-                case 2:
-                    PCMSK0 |= (1 << PCINT2);
-                    break;
-                case 3:
-                    PCMSK0 |= (1 << PCINT3);
-                    break;
-                case 4:
-                    PCMSK0 |= (1 << PCINT4);
-                    break;
-                case 5:
-                    PCMSK0 |= (1 << PCINT5);
-                    break;
-                case 6:
-                    PCMSK0 |= (1 << PCINT6);
-                    break;
-                case 7:
-                    PCMSK0 |= (1 << PCINT7);
-                    break;
-                default:
-                    // Should not happen
-                    break;
-            }
-            return;
-        case C:
-            // Pins in port C are mapped to Pin Change Interrupt 1
-            PCICR |= (1 << PCIE1);
-            switch (pin) {
-                case 0:
-                    PCMSK1 |= (1 << PCINT8);
-                    break;
-                case 1:
-                    PCMSK1 |= (1 << PCINT9);
-                    break;
-                case 2:
-                    PCMSK1 |= (1 << PCINT10);
-                    break;
-                case 3:
-                    PCMSK1 |= (1 << PCINT11);
-                    break;
-                case 4:
-                    PCMSK1 |= (1 << PCINT12);
-                    break;
-                case 5:
-                    PCMSK1 |= (1 << PCINT13);
-                    break;
-                case 6:
-                    PCMSK1 |= (1 << PCINT14);
-                    break;
-                case 7:
-                    // Not defined in avr headers, apparently does not exist
-                    //PCMSK1 |= (1 << PCINT15);
-                    break;
-                default:
-                    // Should not happen
-                    break;
-            }
-            return;
-        case D:
-            // Pins in port D are mapped to Pin Change Interrupt 2
-            PCICR |= (1 << PCIE2);
-            switch (pin) {
-                case 0:
-                    PCMSK2 |= (1 << PCINT16);
-                    break;
-                case 1:
-                    PCMSK2 |= (1 << PCINT17);
-                    break;
-                case 2:
-                    PCMSK2 |= (1 << PCINT18);
-                    break;
-                case 3:
-                    PCMSK2 |= (1 << PCINT19);
-                    break;
-                case 4:
-                    PCMSK2 |= (1 << PCINT20);
-                    break;
-                case 5:
-                    PCMSK2 |= (1 << PCINT21);
-                    break;
-                case 6:
-                    PCMSK2 |= (1 << PCINT22);
-                    break;
-                case 7:
-                    PCMSK2 |= (1 << PCINT23);
-                    break;
-                default:
-                    // Should not happen
-                    break;
-            }
-            return;
-        default:
-            // Should not happen
-            return;
+    if (port > D || pin < 0 || pin > 7) {
+        // Should not happen
+        return;
+    }
+
+    // PCINT15 does not exist, as port C has only seven pins
+    if (port == C && pin == 7) {
+        return;
     }
+
+    *PIN_CHANGE_MASKS[port] |= BV(pin);
+    PCICR |= BV(PIN_CHANGE_ENABLE_BITS[port]);
 }
 
 void initializeTimer0(
@@ -275,3 +191,91 @@ void initializeTimer0(
         break;
     }
 }
+
+
+void initializeTimer1(
+    TimerPrescalerValue prescalerValue,
+    WaveformGenerationMode mode,
+    CounterTop top
+) {
+    switch (prescalerValue) {
+    case PSV_1:
+        TCCR1B |= BV(CS10);
+        TCCR1B &= ~BV(CS12) & ~BV(CS11);
+        break;
+    case PSV_8:
+        TCCR1B |= BV(CS11);
+        TCCR1B &= ~BV(CS12) & ~BV(CS10);
+        break;
+    case PSV_64:
+        TCCR1B |= BV(CS11) | BV(CS10);
+        TCCR1B &= ~BV(CS12);
+        break;
+    case PSV_256:
+        TCCR1B |= BV(CS12);
+        TCCR1B &= ~BV(CS11) & ~BV(CS10);
+        break;
+    case PSV_1024:
+        TCCR1B |= BV(CS12) | BV(CS10);
+        TCCR1B &= ~BV(CS11);
+        break;
+    }
+
+    // Waveform generation bits WGM13..WGM10, as listed in the datasheet table
+    // "Waveform Generation Mode Bit Description".
+    uint8_t wgm = 0;
+    switch (mode) {
+    case NORMAL:
+        wgm = 0x0;
+        break;
+    case PWM_PHASE_CORRECT:
+        switch (top) {
+        case TOP_00FF:
+            wgm = 0x1;
+            break;
+        case TOP_01FF:
+            wgm = 0x2;
+            break;
+        case TOP_02FF:
+            wgm = 0x3;
+            break;
+        case TOP_ICR:
+            wgm = 0xa;
+            break;
+        case TOP_OCRA:
+            wgm = 0xb;
+            break;
+        }
+        break;
+    case PWM_PHASE_AND_FREQUENCY_CORRECT:
+        wgm = (top == TOP_OCRA) ? 0x9 : 0x8;
+        break;
+    case PWM_FAST:
+        switch (top) {
+        case TOP_00FF:
+            wgm = 0x5;
+            break;
+        case TOP_01FF:
+            wgm = 0x6;
+            break;
+        case TOP_02FF:
+            wgm = 0x7;
+            break;
+        case TOP_ICR:
+            wgm = 0xe;
+            break;
+        case TOP_OCRA:
+            wgm = 0xf;
+            break;
+        }
+        break;
+    case CTC:
+        wgm = (top == TOP_ICR) ? 0xc : 0x4;
+        break;
+    }
+
+    TCCR1A &= ~BV(WGM11) & ~BV(WGM10);
+    TCCR1A |= wgm & (BV(WGM11) | BV(WGM10));
+    TCCR1B &= ~BV(WGM13) & ~BV(WGM12);
+    TCCR1B |= (wgm << 1) & (BV(WGM13) | BV(WGM12));
+}
\ No newline at end of file
@@ -3,6 +3,9 @@
 #ifndef _H_OTURPE_AVR_UTILS
 #define _H_OTURPE_AVR_UTILS
 
+#include <avr/io.h>
+#include <stdint.h>
+
 // Cleaner setting of bits
 #define BV(x) (1<<x)
 
@@ -88,7 +91,9 @@ void setData(Port port, int pin, bool enable);
 void setDataDirection(Port port, int pin, bool enable, bool enablePullup = true);
 
 /// \brief
-///    Enables pin change intterupt on the given pin.
+///    Enables pin change intterupt on the given pin. Interrupt service
+///    routines for pin change interrupts are defined with PIN_CHANGE_ISR() in
+///    PinChange.h.
 ///
 /// \param port
 ///    Pin port
@@ -122,4 +127,125 @@ void initializeTimer0(
     CounterTop top
 );
 
+/// \struct PortRegisters
+///
+/// Registers of a single io port, resolved at compile time.
+template<Port port> struct PortRegisters;
+
+template<> struct PortRegisters<B> {
+    static volatile uint8_t& data() { return PORTB; }
+    static volatile uint8_t& input() { return PINB; }
+    static volatile uint8_t& direction() { return DDRB; }
+};
+
+template<> struct PortRegisters<C> {
+    static volatile uint8_t& data() { return PORTC; }
+    static volatile uint8_t& input() { return PINC; }
+    static volatile uint8_t& direction() { return DDRC; }
+};
+
+template<> struct PortRegisters<D> {
+    static volatile uint8_t& data() { return PORTD; }
+    static volatile uint8_t& input() { return PIND; }
+    static volatile uint8_t& direction() { return DDRD; }
+};
+
+/// \struct Pin
+///
+/// Single io pin fixed at compile time. Counterpart of the getData(),
+/// setData() and setDataDirection() functions for pins that are known at
+/// compile time.
+///
+/// All operations are inlined, and port registers and pin masks are constants.
+/// Calling the runtime functions instead costs a call, a switch over the port
+/// and a variable shift.
+template<Port port, uint8_t pin>
+struct Pin {
+    /// Bit mask of the pin within its port
+    static const uint8_t mask = BV(pin);
+
+    /// \brief
+    ///    Read pin value.
+    ///
+    /// \return
+    ///    If pin is high.
+    static bool getData() {
+        return PortRegisters<port>::input() & mask;
+    }
+
+    /// \brief
+    ///    Sets value of the pin data register bit (PORTxn).
+    ///
+    /// \param enable
+    ///    If pin is enabled (high). Otherwise it is disabled (low).
+    static void setData(bool enable) {
+        if (enable) {
+            set();
+        }
+        else {
+            clear();
+        }
+    }
+
+    /// Sets the pin high.
+    static void set() {
+        PortRegisters<port>::data() |= mask;
+    }
+
+    /// Sets the pin low.
+    static void clear() {
+        PortRegisters<port>::data() &= ~mask;
+    }
+
+    /// Inverts the pin by writing to the input register (PINxn).
+    static void toggle() {
+        PortRegisters<port>::input() = mask;
+    }
+
+    /// \brief
+    ///    Sets value of the pin data direction register bit (DDRxn).
+    ///
+    /// \param enable
+    ///    If pin is enabled (output) or disabled (input)
+    ///
+    /// \param enablePullup
+    ///    If pullup resistor is enabled. This value is only used when
+    ///    configuring an input pin.
+    static void setDataDirection(bool enable, bool enablePullup = true) {
+        if (enable) {
+            PortRegisters<port>::direction() |= mask;
+        }
+        else {
+            PortRegisters<port>::direction() &= ~mask;
+            setData(enablePullup);
+        }
+    }
+};
+
+/// Initializes timer 1 by setting waveform generation mode and prescaler.
+///
+/// This function assumes that neither Clock Select nor Waveform Generation bits
+/// have not been touched yet. Note that timer 1 does not support all
+/// TimerPrescalerValue values. If illegal value is entered, prescaler is not
+/// set to any value.
+///
+/// Parameter top selects the counter TOP for pulse width modulation and clear
+/// timer on compare match modes. In CTC mode, only TOP_OCRA and TOP_ICR are
+/// meaningful. In NORMAL mode, top is always 0xffff and the parameter is not
+/// used.
+///
+/// \param prescalerValue
+///    Requested prescaler value
+///
+/// \param mode
+///    Waveform generation mode
+///
+/// \param top
+///    Selection of counter TOP
+void initializeTimer1(
+    TimerPrescalerValue prescalerValue,
+    WaveformGenerationMode mode,
+    CounterTop top
+);
+
 #endif //_H_OTURPE_AVR_UTILS
@@ -0,0 +1,28 @@
+// Cpu load probe. Drives a pin high while an interrupt service routine is
+// running. See config.h for enabling.
+
+#ifndef _H_CPU_LOAD_PROBE
+#define _H_CPU_LOAD_PROBE
+
+#include "config.h"
+
+#include <avr/io.h>
+
+#ifdef CPU_LOAD_PROBE_PORT
+
+/// Configures the probe pin as output. Call once at startup.
+#define CPU_LOAD_PROBE_INIT() (CPU_LOAD_PROBE_DDR |= (1 << CPU_LOAD_PROBE_PIN))
+/// Marks start of a measured section. Compiles to a single sbi instruction.
+#define CPU_LOAD_PROBE_BEGIN() (CPU_LOAD_PROBE_PORT |= (1 << CPU_LOAD_PROBE_PIN))
+/// Marks end of a measured section. Compiles to a single cbi instruction.
+#define CPU_LOAD_PROBE_END() (CPU_LOAD_PROBE_PORT &= ~(1 << CPU_LOAD_PROBE_PIN))
+
+#else
+
+#define CPU_LOAD_PROBE_INIT()
+#define CPU_LOAD_PROBE_BEGIN()
+#define CPU_LOAD_PROBE_END()
+
+#endif
+
+#endif
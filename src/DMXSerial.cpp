@@ -9,7 +9,11 @@
 // Heavily simplified by Otto Urpelainen. Anything not needed to send data using Atmega328P was removed.
 
 #include "DMXSerial.h"
+#include "AvrUtils.h"
+#include "Instrumentation.h"
+#include "Timebase.h"
 #include <avr/interrupt.h>
+#include <util/atomic.h>
 
 // ----- Constants -----
 
@@ -29,6 +33,18 @@
 #define BREAKFORMAT    SERIAL_8E1
 #define DMXFORMAT      SERIAL_8N2
 
+// with DMX_TIMER_BREAK, the break and mark-after-break are timed with timer 1 compare A instead
+#define BREAKTICKS     TIMEBASE_US_TO_TICKS(DMX_BREAK_LENGTH)
+#define MABTICKS       TIMEBASE_US_TO_TICKS(DMX_MAB_LENGTH)
+
+// the USART TX pin, driven as a normal output during a timed break
+typedef Pin<D, PD1> DmxTxPin;
+
+// the shortest legal time from the start of one break to the start of the next one is 1204 usec
+// idle gaps shorter than the margin are not inserted, because the timer compare could be missed
+#define MINFRAMETICKS  TIMEBASE_US_TO_TICKS(1204)
+#define GAPMARGINTICKS TIMEBASE_US_TO_TICKS(20)
+
 // ----- Macros -----
 
 // calculate prescaler from baud rate and cpu clock rate at compile time
@@ -43,9 +59,44 @@ int _dmxChannel;  // the next channel byte to be sent.
 
 volatile unsigned int _dmxMaxChannel = 32; // the last channel used for sending (1..32).
 
+// Frame timing, in timebase ticks. Frame period 0 means that frames are sent back to back.
+volatile uint32_t _dmxFramePeriod = 0;
+uint16_t _dmxFrameStart;     // timebase value at the start of the current frame
+uint32_t _dmxGapRemaining;   // remaining idle gap after the current compare match
+
+// What the next timer 1 compare A match ends.
+enum DMXTimerPhase { DMX_PHASE_GAP, DMX_PHASE_BREAK, DMX_PHASE_MAB };
+DMXTimerPhase _dmxTimerPhase;
+
+// Frame rate measurement. Frames are counted until their total duration reaches one second.
+uint32_t _dmxRateTicks = 0;
+uint16_t _dmxRateFrames = 0;
+volatile uint16_t _dmxFramesPerSecond = 0;
+
 // Array of DMX values (raw).
 // Entry 0 will never be used for DMX data but will store the startbyte (0 for DMX mode).
+// In double buffer mode, there are three arrays: the front buffer is being sent by the interrupt routines,
+// the ready buffer holds committed values waiting for the next break and the back buffer is written by the
+// application. commit() swaps the back and ready buffers and the interrupt routine swaps the ready and front
+// buffers at the break, so neither side ever waits for the other.
+#ifdef DMX_DOUBLE_BUFFER
+uint8_t _dmxData[3][DMXSERIAL_MAX+1];
+uint8_t *_dmxFront = _dmxData[0];
+uint8_t *_dmxReady = _dmxData[1];
+uint8_t *_dmxBack = _dmxData[2];
+#else
 uint8_t _dmxData[DMXSERIAL_MAX+1];
+uint8_t *_dmxFront = _dmxData;
+uint8_t *_dmxBack = _dmxData;
+#endif
+
+// Set by commit(), cleared by the interrupt routine when the ready buffer has been taken into use.
+volatile bool _dmxCommitPending = false;
+// Set by commit(). The back buffer then holds older values and has to be brought up to date from the
+// committed buffer before it is accessed.
+bool _dmxBackOutdated = false;
+// Buffer with the latest committed values. Either the ready or the front buffer, and never written to.
+uint8_t *_dmxCommitted = _dmxFront;
 
 // Create a single class instance. Multiple class instances (multiple simultaneous DMX ports) are not supported.
 DMXSerialClass DMXSerial;
@@ -57,6 +108,11 @@ void _DMXSerialInit(uint16_t baud_setting, uint8_t mode, uint8_t format);
 inline void _DMXSerialWriteByte(uint8_t data);
 
 void _DMXStartSending();
+void _DMXStartBreak(uint32_t frameTicks);
+void _DMXSendBreak(uint16_t now);
+bool _DMXStartIdleGap();
+void _DMXScheduleGapStep(uint16_t from);
+void _DMXPrepareBackBuffer();
 
 
 // ----- Class implementation -----
@@ -67,13 +123,26 @@ void DMXSerialClass::init()
   // initialize global variables
   _dmxChannel = 0;
 
-  // initialize the DMX buffer
+  // initialize the DMX buffers
   for (int n = 0; n < DMXSERIAL_MAX+1; n++) {
-    _dmxData[n] = 0;
+    _dmxFront[n] = 0;
+    _dmxBack[n] = 0;
+#ifdef DMX_DOUBLE_BUFFER
+    _dmxReady[n] = 0;
+#endif
   }
+  _dmxCommitPending = false;
+  _dmxBackOutdated = false;
 
   // now start
-  _dmxMaxChannel = 32; // The default in Controller mode is sending 32 channels.
+#ifdef DMX_MINIMAL_FRAME
+  _dmxMaxChannel = 1; // Follows the highest channel written.
+#else
+  // The default in Controller mode is sending 32 channels, or the whole universe if it is smaller.
+  _dmxMaxChannel = DMXSERIAL_MAX < 32 ? DMXSERIAL_MAX : 32;
+#endif
+  initializeTimebase();
+  refreshRate(DMX_REFRESH_RATE);
   _DMXStartSending();      
 }
 
@@ -89,6 +158,32 @@ void DMXSerialClass::maxChannel(int channel)
 }
 
 
+// Set the target refresh rate.
+// Frames are padded with idle time (mark before break) to the requested period. Frames with few channels are
+// padded to the shortest legal length also when no rate is given.
+void DMXSerialClass::refreshRate(uint16_t framesPerSecond)
+{
+  uint32_t period = 0;
+  if (framesPerSecond > 0) period = TIMEBASE_TICKS_PER_SECOND / framesPerSecond;
+  if (period < MINFRAMETICKS) period = MINFRAMETICKS;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    _dmxFramePeriod = period;
+  }
+}
+
+
+// Return the number of frames sent during the latest full second.
+uint16_t DMXSerialClass::framesPerSecond()
+{
+  uint16_t frames;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    frames = _dmxFramesPerSecond;
+  }
+  return(frames);
+}
+
+
 // Read the current value of a channel.
 uint8_t DMXSerialClass::read(int channel)
 {
@@ -96,7 +191,8 @@ uint8_t DMXSerialClass::read(int channel)
   if (channel < 1) channel = 1;
   if (channel > DMXSERIAL_MAX) channel = DMXSERIAL_MAX;
 
-  return(_dmxData[channel]);
+  _DMXPrepareBackBuffer();
+  return(_dmxBack[channel]);
 }
 
 
@@ -106,13 +202,15 @@ uint8_t DMXSerialClass::read(int channel)
 void DMXSerialClass::write(int channel, uint8_t value)
 {
   // adjust parameters
+  // channels outside the universe are ignored, so that they do not overwrite the last channel
   if (channel < 1) channel = 1;
-  if (channel > DMXSERIAL_MAX) channel = DMXSERIAL_MAX;
+  if (channel > DMXSERIAL_MAX) return;
   if (value < 0) value = 0;
   if (value > 255) value = 255;
 
   // store value for later sending
-  _dmxData[channel] = value;
+  _DMXPrepareBackBuffer();
+  _dmxBack[channel] = value;
 
   // Make sure we transmit enough channels for the ones used
   if (channel > _dmxMaxChannel) {
@@ -121,10 +219,76 @@ void DMXSerialClass::write(int channel, uint8_t value)
 }
 
 
+// Write values into consecutive channels.
+// Values outside the supported channel range are ignored.
+void DMXSerialClass::writeRange(int channel, const uint8_t *values, int count)
+{
+  if (channel < 1) {
+    values += 1 - channel;
+    count -= 1 - channel;
+    channel = 1;
+  }
+  if (channel + count - 1 > DMXSERIAL_MAX) count = DMXSERIAL_MAX - channel + 1;
+  if (count <= 0) return;
+
+  _DMXPrepareBackBuffer();
+  uint8_t *destination = _dmxBack + channel;
+  for (int n = 0; n < count; n++) {
+    destination[n] = values[n];
+  }
+
+  // Make sure we transmit enough channels for the ones used
+  int last = channel + count - 1;
+  if (last > _dmxMaxChannel) {
+    _dmxMaxChannel = last;
+  }
+}
+
+
+// Publish the values written since the previous commit.
+// In double buffer mode, the back buffer becomes the ready buffer, which the interrupt routine takes into use at
+// the start of the next frame. A commit that has not been sent yet is replaced. Never waits.
+void DMXSerialClass::commit()
+{
+#ifdef DMX_DOUBLE_BUFFER
+  // an outdated back buffer must not be published as such
+  _DMXPrepareBackBuffer();
+
+  uint8_t *committed = _dmxBack;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    _dmxBack = _dmxReady;
+    _dmxReady = committed;
+    _dmxCommitPending = true;
+  }
+  _dmxCommitted = committed;
+  _dmxBackOutdated = true;
+#endif
+  INSTRUMENT_LATENCY_COMMIT();
+}
+
+
+// Tell if committed values are still waiting for the next frame.
+bool DMXSerialClass::isCommitPending()
+{
+  return(_dmxCommitPending);
+}
+
+
 // Return the DMX buffer of unsave direct but faster access 
+// In double buffer mode, this is the back buffer and it is valid only until the next commit().
 uint8_t *DMXSerialClass::getBuffer()
 {
-  return(_dmxData);
+  _DMXPrepareBackBuffer();
+  return(_dmxBack);
+}
+
+
+// Return the DMX buffer without bringing it up to date, for callers that write all channels in use.
+uint8_t *DMXSerialClass::getRewriteBuffer()
+{
+  // later writes must not copy the committed values over the rewritten ones
+  _dmxBackOutdated = false;
+  return(_dmxBack);
 }
 
 
@@ -139,6 +303,23 @@ void DMXSerialClass::term(void)
 // ----- internal functions and interrupt implementations -----
 
 
+// Make the back buffer ready for writing.
+// After a commit, copy the values just committed into the new back buffer, so that writes continue from the
+// latest values. The committed buffer is only read by the interrupt routine, so this does not have to wait for the
+// break. Only channels that are being sent need to be copied.
+void _DMXPrepareBackBuffer()
+{
+#ifdef DMX_DOUBLE_BUFFER
+  if (_dmxBackOutdated) {
+    for (unsigned int n = 0; n <= _dmxMaxChannel; n++) {
+      _dmxBack[n] = _dmxCommitted[n];
+    }
+    _dmxBackOutdated = false;
+  }
+#endif
+}
+
+
 // Initialize the Hardware serial port with the given baud rate
 // using 8 data bits, no parity, 2 stop bits for data
 // and 8 data bits, even parity, 1 stop bit for the break
@@ -159,11 +340,112 @@ void _DMXSerialInit(uint16_t baud_setting, uint8_t mode, uint8_t format)
 // Setup Hardware for Sending
 void _DMXStartSending()
 {
+  _dmxFrameStart = getTimebaseTicks();
+  _dmxRateTicks = 0;
+  _dmxRateFrames = 0;
+
+#ifdef DMX_TIMER_BREAK
+  // The USART stays at DMX speed and format all the time. During the break it is disabled
+  // and the TX pin is driven as a normal output.
+  _DMXSerialInit(Calcprescale(DMXSPEED), (1 << TXEN0), DMXFORMAT);
+  DmxTxPin::setDataDirection(true);
+#endif
+
   // Start sending a BREAK and send more bytes in UDRE ISR
+  _DMXSendBreak(_dmxFrameStart);
+}
+
+
+// Start a new frame by sending a BREAK. Called from interrupt routines only.
+// frameTicks is the duration of the frame that just ended, or 0 if it has to be measured.
+void _DMXStartBreak(uint32_t frameTicks)
+{
+  uint16_t now = TCNT1;
+  if (frameTicks == 0) {
+    frameTicks = (uint16_t)(now - _dmxFrameStart);
+    _dmxFrameStart = now;
+  } else {
+    // the frame was padded, so it starts exactly one period after the previous one
+    _dmxFrameStart += (uint16_t)frameTicks;
+  }
+
+  // frame rate
+  _dmxRateFrames++;
+  _dmxRateTicks += frameTicks;
+  if (_dmxRateTicks >= TIMEBASE_TICKS_PER_SECOND) {
+    _dmxFramesPerSecond = _dmxRateFrames;
+    _dmxRateFrames = 0;
+    _dmxRateTicks -= TIMEBASE_TICKS_PER_SECOND;
+  }
+
+#ifdef DMX_DOUBLE_BUFFER
+  // a new frame starts here, so this is where committed values are taken into use
+  if (_dmxCommitPending) {
+    uint8_t *committed = _dmxReady;
+    _dmxReady = _dmxFront;
+    _dmxFront = committed;
+    _dmxCommitPending = false;
+    INSTRUMENT_LATENCY_SWAP();
+  }
+#else
+  // values written so far are sent in the frame starting now
+  INSTRUMENT_LATENCY_SWAP();
+#endif
+
+  _DMXSendBreak(now);
+}
+
+
+// Start the BREAK. With DMX_TIMER_BREAK the line is pulled low until timer 1 compare A ends the break,
+// otherwise a zero byte is sent at BREAKSPEED.
+void _DMXSendBreak(uint16_t now)
+{
+#ifdef DMX_TIMER_BREAK
+  UCSR0B = 0;
+  DmxTxPin::clear();
+
+  _dmxTimerPhase = DMX_PHASE_BREAK;
+  OCR1A = now + BREAKTICKS;
+  TIFR1 = (1 << OCF1A);
+  TIMSK1 |= (1 << OCIE1A);
+#else
   // Enable transmitter and interrupt
   _DMXSerialInit(Calcprescale(BREAKSPEED), ((1 << TXEN0) | (1 << TXCIE0)), BREAKFORMAT);
-
   _DMXSerialWriteByte((uint8_t)0);
+#endif
+  _dmxChannel = 0;
+}
+
+
+// Start an idle gap after the last data byte if the frame period requires it. Called from interrupt routines only.
+// Returns false if no gap is needed.
+bool _DMXStartIdleGap()
+{
+  uint32_t period = _dmxFramePeriod;
+  uint16_t now = TCNT1;
+  uint16_t elapsed = now - _dmxFrameStart;
+  if (elapsed + GAPMARGINTICKS >= period) return(false);
+
+  _dmxGapRemaining = period - elapsed;
+  _DMXScheduleGapStep(now);
+
+  // keep the transmitter enabled, so that the line stays at mark, but disable USART interrupts
+  UCSR0B = (1 << TXEN0);
+  return(true);
+}
+
+
+// Schedule the next timer compare match of the idle gap.
+// Gaps longer than the timer range are split into several compare matches.
+void _DMXScheduleGapStep(uint16_t from)
+{
+  uint16_t step = _dmxGapRemaining > 0x8000 ? 0x8000 : _dmxGapRemaining;
+  _dmxGapRemaining -= step;
+
+  _dmxTimerPhase = DMX_PHASE_GAP;
+  OCR1A = from + step;
+  TIFR1 = (1 << OCF1A);
+  TIMSK1 |= (1 << OCIE1A);
 }
 
 
@@ -184,12 +466,14 @@ inline void _DMXSerialWriteByte(uint8_t data)
 // In DMXController mode when the buffer was sent completely the DMX sequence will resent, starting with a BREAK pattern.
 ISR(USART_TX_vect)
 {
+  INSTRUMENT_ISR_BEGIN(PROBE_DMX_TX_ISR);
+
   if (_dmxChannel == -1) {
     // this interrupt occurs after the stop bits of the last data byte
-    // start sending a BREAK and loop forever in ISR
-    _DMXSerialInit(Calcprescale(BREAKSPEED), ((1 << TXEN0) | (1 << TXCIE0)), BREAKFORMAT);
-    _DMXSerialWriteByte((uint8_t)0);
-    _dmxChannel = 0;
+    // start sending a BREAK and loop forever in ISR, unless the frame has to be padded with an idle gap first
+    if (!_DMXStartIdleGap()) {
+      _DMXStartBreak(0);
+    }
 
   } else if (_dmxChannel == 0) {
     // this interrupt occurs after the stop bits of the break byte
@@ -202,17 +486,65 @@ ISR(USART_TX_vect)
     _DMXSerialWriteByte((uint8_t)0);
     _dmxChannel = 1;
   }
+
+  INSTRUMENT_ISR_END(PROBE_DMX_TX_ISR);
 }
 
 
   // this interrupt occurs after the start bit of the previous data byte
 ISR(USART_UDRE_vect)
 {
-  _DMXSerialWriteByte(_dmxData[_dmxChannel++]);
+  INSTRUMENT_ISR_BEGIN(PROBE_DMX_UDRE_ISR);
+
+  INSTRUMENT_LATENCY_SLOT(_dmxChannel);
+  _DMXSerialWriteByte(_dmxFront[_dmxChannel++]);
 
   if (_dmxChannel > _dmxMaxChannel) {
      // this series is done. Next time: restart with break.
      _dmxChannel = -1;
+#ifdef DMX_TIMER_BREAK
+    // speed and format are already right, only switch to TX finished interrupt
+    UCSR0B = (1 << TXEN0) | (1 << TXCIE0);
+#else
     _DMXSerialInit(Calcprescale(DMXSPEED), ((1 << TXEN0) | (1 << TXCIE0)), DMXFORMAT);
+#endif
   }
-}
\ No newline at end of file
+
+  INSTRUMENT_ISR_END(PROBE_DMX_UDRE_ISR);
+}
+
+
+// this interrupt occurs when an idle gap step, a timed break or a timed mark-after-break ends
+ISR(TIMER1_COMPA_vect)
+{
+  INSTRUMENT_ISR_BEGIN(PROBE_DMX_TIMER_ISR);
+
+  switch (_dmxTimerPhase) {
+  case DMX_PHASE_GAP:
+    if (_dmxGapRemaining > 0) {
+      _DMXScheduleGapStep(OCR1A);
+    } else {
+      TIMSK1 &= ~(1 << OCIE1A);
+      _DMXStartBreak(_dmxFramePeriod);
+    }
+    break;
+
+  case DMX_PHASE_BREAK:
+    // release the line for the mark-after-break
+    DmxTxPin::set();
+    _dmxTimerPhase = DMX_PHASE_MAB;
+    OCR1A += MABTICKS;
+    break;
+
+  case DMX_PHASE_MAB:
+    // give the line back to the USART and write start code
+    // take next interrupt when data register empty (early)
+    TIMSK1 &= ~(1 << OCIE1A);
+    UCSR0B = (1 << TXEN0) | (1 << UDRIE0);
+    _DMXSerialWriteByte((uint8_t)0);
+    _dmxChannel = 1;
+    break;
+  }
+
+  INSTRUMENT_ISR_END(PROBE_DMX_TIMER_ISR);
+}
@@ -13,7 +13,9 @@
 
 #include <avr/io.h>
 
-#define DMXSERIAL_MAX 512 ///< max. number of supported DMX data channels
+#define DMXSERIAL_MAX DMX_UNIVERSE_SIZE ///< max. number of supported DMX data channels, set in config.h
+
+static_assert(DMXSERIAL_MAX >= 1 && DMXSERIAL_MAX <= 512, "DMX universe size must be between 1 and 512");
 
 // ----- Library Class -----
 
@@ -42,7 +44,22 @@ class DMXSerialClass
     void maxChannel(int channel);
 
     /**
-     * @brief Read the current value of a channel.
+     * @brief Set the target refresh rate.
+     * After each frame, the line is held idle until the frame period has passed. Frames are always at least as
+     * long as the standard requires, even if they carry only a few channels.
+     * @param [in] framesPerSecond Target frames per second, or 0 to send frames back to back.
+     * @return void
+     */
+    void refreshRate(uint16_t framesPerSecond);
+
+    /**
+     * @brief Get the measured refresh rate.
+     * @return uint16_t The number of frames sent during the latest full second.
+     */
+    uint16_t framesPerSecond();
+
+    /**
+     * @brief Read the latest written value of a channel.
      * @param [in] channel The channel number.
      * @return uint8_t The current value.
      */
@@ -50,18 +67,58 @@ class DMXSerialClass
 
     /**
      * @brief Write a new value to a channel.
+     * Channels above the universe size are ignored.
      * @param [in] channel The channel number.
      * @param [in] value The current value.
      * @return void
      */
     void write(int channel, uint8_t value);
 
+    /**
+     * @brief Write new values to consecutive channels.
+     * @param [in] channel The first channel number.
+     * @param [in] values The new values.
+     * @param [in] count The number of channels to write.
+     * @return void
+     */
+    void writeRange(int channel, const uint8_t *values, int count);
+
+    /**
+     * @brief Publish the values written since the previous commit.
+     * In double buffer mode (DMX_DOUBLE_BUFFER in config.h), written values are sent only after commit. The
+     * committed values are taken into use at the break starting the next frame, so every frame carries either all
+     * or none of the values written before the commit. If a previous commit has not been sent yet, it is replaced.
+     * Neither commit nor the writes after it wait for the break. Without double buffering, values are sent as soon
+     * as they are written and commit does nothing.
+     * The first read, write or getBuffer() after a commit copies the committed values of all sent channels
+     * (maxChannel + 1 bytes) into the new back buffer. getRewriteBuffer() skips the copy.
+     * @return void
+     */
+    void commit();
+
+    /**
+     * @brief Tell if committed values are still waiting for the next frame.
+     * Always false without double buffering.
+     * @return bool true if the latest commit has not been taken into use yet.
+     */
+    bool isCommitPending();
+
     /**
      * @brief Get a pointer to DMX Buffer.
      * This is the internal byte-array where the current DMX values are stored. 
+     * In double buffer mode, this is the back buffer, which is valid only until the next commit.
      * @return uint8_t DMX values buffer.
      */
     uint8_t *getBuffer();
+
+    /**
+     * @brief Get a pointer to the DMX buffer for rewriting all channels in use.
+     * Like getBuffer(), but in double buffer mode the latest committed values are not copied into the buffer, so
+     * it holds the values of an older commit. Every channel in use has to be written before the next commit.
+     * Valid only until the next commit.
+     * @return uint8_t DMX values buffer.
+     */
+    uint8_t *getRewriteBuffer();
     
     /**
      * @brief Terminate the current operation mode.
@@ -0,0 +1,101 @@
+#include "DistanceFilter.h"
+
+DistanceFilter::DistanceFilter() :
+    oldest(0),
+    average(0),
+    isInitialized(false),
+    outlierRun(0),
+    missRun(0),
+    rejectedCount(0) {
+}
+
+uint16_t DistanceFilter::add(uint16_t distance) {
+    missRun = 0;
+
+    if (!isInitialized) {
+        for (uint8_t i = 0; i < DISTANCE_FILTER_WINDOW; i++) {
+            history[i] = distance;
+            sorted[i] = distance;
+        }
+        average = (uint32_t)distance << DISTANCE_FILTER_EMA_SHIFT;
+        isInitialized = true;
+        return distance;
+    }
+
+    if (DISTANCE_FILTER_OUTLIER_LIMIT > 0) {
+        uint16_t current = get();
+        uint16_t deviation = distance > current ?
+            distance - current :
+            current - distance;
+        if (deviation <= DISTANCE_FILTER_OUTLIER_LIMIT) {
+            outlierRun = 0;
+        }
+        else if (outlierRun < DISTANCE_FILTER_OUTLIER_COUNT) {
+            outlierRun++;
+            if (rejectedCount != 0xffff) {
+                rejectedCount++;
+            }
+            return current;
+        }
+        // Otherwise, outliers have persisted long enough to be taken as a
+        // real change. They are accepted until the output catches up.
+    }
+
+    uint16_t median = updateMedian(distance);
+
+    // Average is kept scaled, so that the update needs only a shift, an
+    // addition and a subtraction.
+    average -= average >> DISTANCE_FILTER_EMA_SHIFT;
+    average += median;
+
+    return get();
+}
+
+void DistanceFilter::addMiss() {
+    missRun++;
+    if (missRun == DISTANCE_FILTER_RESET_COUNT) {
+        reset();
+    }
+}
+
+void DistanceFilter::reset() {
+    average = 0;
+    isInitialized = false;
+    outlierRun = 0;
+    missRun = 0;
+}
+
+uint16_t DistanceFilter::get() {
+    return average >> DISTANCE_FILTER_EMA_SHIFT;
+}
+
+uint16_t DistanceFilter::getRejectedCount() {
+    return rejectedCount;
+}
+
+uint16_t DistanceFilter::updateMedian(uint16_t distance) {
+    uint16_t removed = history[oldest];
+    history[oldest] = distance;
+    oldest++;
+    if (oldest == DISTANCE_FILTER_WINDOW) {
+        oldest = 0;
+    }
+
+    // Find the removed sample and slide the new one into its sorted position
+    // from there. The window stays sorted without a full sort.
+    uint8_t i = 0;
+    while (sorted[i] != removed) {
+        i++;
+    }
+    while (i > 0 && sorted[i - 1] > distance) {
+        sorted[i] = sorted[i - 1];
+        i--;
+    }
+    while (i < DISTANCE_FILTER_WINDOW - 1 && sorted[i + 1] < distance) {
+        sorted[i] = sorted[i + 1];
+        i++;
+    }
+    sorted[i] = distance;
+
+    return sorted[DISTANCE_FILTER_WINDOW / 2];
+}
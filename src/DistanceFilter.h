@@ -0,0 +1,103 @@
+#ifndef _H_DISTANCE_FILTER
+#define _H_DISTANCE_FILTER
+
+#include "config.h"
+
+#include <stdint.h>
+
+/// \class DistanceFilter
+///
+/// Filters distance readings to suppress spurious echoes. Each sample passes
+/// three stages, each of which can be configured in config.h:
+///
+/// 1. Outlier rejection. A sample too far from the current output is dropped,
+///    unless enough such samples arrive in a row, in which case they are
+///    taken as real change.
+/// 2. Sliding median over a window of fixed size.
+/// 3. Exponential moving average.
+///
+/// All arithmetic is integer. Cost per sample is bounded by the window size,
+/// which is fixed at compile time.
+class DistanceFilter {
+    static_assert(
+        DISTANCE_FILTER_WINDOW > 0 && DISTANCE_FILTER_WINDOW % 2 == 1,
+        "Median window size must be odd"
+    );
+    static_assert(
+        DISTANCE_FILTER_RESET_COUNT > 0 && DISTANCE_FILTER_RESET_COUNT <= 255,
+        "Reset count must fit in 8 bits"
+    );
+
+public:
+    /// \brief
+    ///    Initializes a new filter. The first sample added fills the whole
+    ///    window.
+    DistanceFilter();
+
+public:
+    /// \brief
+    ///    Adds a new sample to the filter.
+    ///
+    /// \param distance
+    ///    Measured distance
+    ///
+    /// \return
+    ///    Filtered distance
+    uint16_t add(uint16_t distance);
+
+    /// \brief
+    ///    Records a ping that found no target, or failed. After
+    ///    DISTANCE_FILTER_RESET_COUNT of them in a row, the filter is reset.
+    void addMiss();
+
+    /// \brief
+    ///    Forgets all samples. The next sample added fills the whole window
+    ///    again, like after construction.
+    void reset();
+
+    /// \brief
+    ///    Returns current filtered distance.
+    ///
+    /// \return
+    ///    Filtered distance, or 0 if no samples have been added.
+    uint16_t get();
+
+    /// \brief
+    ///    Returns number of samples rejected as outliers.
+    ///
+    /// \return
+    ///    Rejected sample count. Saturates at maximum value.
+    uint16_t getRejectedCount();
+
+private:
+    /// Samples in the median window, in order of arrival
+    uint16_t history[DISTANCE_FILTER_WINDOW];
+    /// Samples in the median window, in ascending order
+    uint16_t sorted[DISTANCE_FILTER_WINDOW];
+    /// Index of oldest sample in history
+    uint8_t oldest;
+
+    /// Moving average scaled by 2^DISTANCE_FILTER_EMA_SHIFT
+    uint32_t average;
+
+    /// If any samples have been added
+    bool isInitialized;
+    /// Number of consecutive rejected samples
+    uint8_t outlierRun;
+    /// Number of consecutive pings without a target
+    uint8_t missRun;
+    /// Total number of rejected samples
+    uint16_t rejectedCount;
+
+    /// \brief
+    ///    Replaces the oldest sample in median window.
+    ///
+    /// \param distance
+    ///    New sample
+    ///
+    /// \return
+    ///    Median of the window
+    uint16_t updateMedian(uint16_t distance);
+};
+
+#endif
@@ -4,64 +4,333 @@
 
 #include "DistanceSensorController.h"
 
-#include <util/delay.h>
+#include "EchoTrace.h"
+#include "PinChange.h"
+#include "RingBuffer.h"
+#include "Scheduler.h"
+#include "Timebase.h"
+
 #include <avr/interrupt.h>
+#include <util/atomic.h>
+
+// Conversion factor from timebase ticks to millimeters, as an unsigned 0.16
+// fixed point number. Computed at compile time, so that conversion needs only
+// a 16 x 16 bit multiplication and taking the high word of the result.
+static const uint16_t MM_PER_TICK_Q16 = (uint16_t)(
+    (
+        (uint64_t)DISTANCE_SENSOR_MM_PER_MS * 1000 * TIMEBASE_PRESCALER
+            * 65536 + F_CPU / 2
+    ) / F_CPU
+);
+static_assert(
+    (uint64_t)DISTANCE_SENSOR_MM_PER_MS * TIMEBASE_PRESCALER * 1000 < F_CPU,
+    "Distance of a single timer tick must be less than 1 mm"
+);
+
+// Ping timing in timebase ticks
+static const uint16_t TRIGGER_TICKS =
+    TIMEBASE_US_TO_TICKS(DISTANCE_SENSOR_TRIGGER_LENGTH);
+static const uint16_t ECHO_TIMEOUT_TICKS =
+    TIMEBASE_US_TO_TICKS(DISTANCE_SENSOR_ECHO_TIMEOUT);
+static_assert(
+    DISTANCE_SENSOR_ECHO_TIMEOUT < 32768,
+    "Echo timeout must fit in a single timebase period"
+);
+
+// Longest step of ping recovery. Longer recovery times are split into several
+// compare matches.
+static const uint16_t RECOVERY_STEP_TICKS = 0x8000;
+
+// Ping deferral while the echo of the previous ping is still high
+static const uint16_t DEFER_STEP_TICKS = TIMEBASE_US_TO_TICKS(1000);
+static const uint8_t MAX_DEFERRALS = DISTANCE_SENSOR_STUCK_ECHO_TIME / 1000;
+static_assert(
+    DISTANCE_SENSOR_STUCK_ECHO_TIME / 1000 < 256,
+    "Stuck echo time must be less than 256 ms"
+);
+
+// Echo timing as recorded by the interrupt
+struct EchoSample {
+    // Sensor index
+    uint8_t sensor;
+    // Ping sequence number
+    uint8_t sequence;
+    // Ping result. Only DISTANCE_VALID and DISTANCE_OUT_OF_RANGE have a delay.
+    DistanceStatus status;
+    // Timer 1 value at the end of the ping
+    uint16_t timestamp;
+    // Ultrasound travel delay in timer 1 ticks
+    uint16_t delay;
+};
+
+// Sensor pins
+static constexpr uint8_t TRIGGER_PINS[] = DISTANCE_SENSOR_TRIGGER_PINS;
+static constexpr uint8_t ECHO_PINS[] = DISTANCE_SENSOR_ECHO_PINS;
+
+static_assert(
+    sizeof(TRIGGER_PINS) == DISTANCE_SENSOR_COUNT
+        && sizeof(ECHO_PINS) == DISTANCE_SENSOR_COUNT,
+    "A trigger and an echo pin must be given for each sensor"
+);
+
+// Returns port bit mask of the first count pins of a list. Evaluated at
+// compile time.
+static constexpr uint8_t pinMask(const uint8_t* pins, uint8_t count) {
+    return count == 0 ? 0 : BV(pins[count - 1]) | pinMask(pins, count - 1);
+}
+
+// Masks of the pins of all sensors, for setting them up at once
+static const uint8_t TRIGGER_MASK =
+    pinMask(TRIGGER_PINS, DISTANCE_SENSOR_COUNT);
+static const uint8_t ECHO_MASK = pinMask(ECHO_PINS, DISTANCE_SENSOR_COUNT);
+
+typedef PortRegisters<DISTANCE_SENSOR_TRIGGER_PORT> TriggerPort;
+typedef PortRegisters<DISTANCE_SENSOR_ECHO_PORT> EchoPort;
+typedef PinChange<DISTANCE_SENSOR_ECHO_PORT> EchoPinChange;
+
+// Step of the ping sequence, advanced by the compare interrupt and the echo
+// interrupt
+enum PingPhase {
+    // Trigger pulse is high
+    PING_TRIGGER,
+    // Waiting for echo to end
+    PING_ECHO,
+    // Waiting before next ping
+    PING_RECOVERY
+};
+
+PingPhase pingPhase = PING_RECOVERY;
+// Index of the sensor being pinged
+uint8_t pingSensor = 0;
+// Pause between end of a ping and start of the next one in timebase ticks
+uint32_t pingRecoveryTicks =
+    TIMEBASE_US_TO_TICKS(DISTANCE_SENSOR_PING_RECOVERY);
+// Remaining recovery time after the current compare match
+uint32_t pingRecoveryRemaining = 0;
+// Sequence number of the current ping
+uint8_t pingSequence = 0;
+// If echo of the current ping has started
+bool isEchoStarted = false;
+// Number of times the current ping has been deferred
+uint8_t pingDeferrals = 0;
 
-// Ultrasound travel delay
-uint32_t counter = 0;
-uint32_t delay = 0;
-
-Port echoPortStatic;
-uint8_t echoPinStatic;
-
-DistanceSensorController::DistanceSensorController(
-    Port triggerPort,
-    uint8_t triggerPin,
-    Port echoPort,
-    uint8_t echoPin
-) :
-    triggerPort(triggerPort),
-    triggerPin(triggerPin),
-    echoPort(echoPort),
-    echoPin(echoPin),
-    triggerState(false) {
-    // Interrupt need to know the echo pin, too
-    echoPortStatic = echoPort;
-    echoPinStatic = echoPin;
-
-    setDataDirection(triggerPort, triggerPin, true);    
-    setDataDirection(echoPort, echoPin, false, false);    
-
-    setData(triggerPort, triggerPin, false);
-
-    enablePinChangeInterrupt(echoPort, echoPin);
-
-    initializeTimer0(PSV_1, NORMAL, TOP_00FF);
-    // Enable interrupt on overflow
-    TIMSK0 |= BV(TOIE0);
+// Task triggered when a measurement is queued, or -1 for none
+int8_t measurementTask = -1;
+
+// Port bit mask of the trigger and echo pin of each sensor, so that the
+// interrupts need no variable shifts
+uint8_t triggerMasks[DISTANCE_SENSOR_COUNT];
+uint8_t echoMasks[DISTANCE_SENSOR_COUNT];
+
+// Sensor index of each echo port bit
+uint8_t echoSensor[8];
+// Timer 1 value at the rising edge of echo, for each echo port bit
+uint16_t echoStart[8];
+// Echo samples waiting to be read
+RingBuffer<EchoSample, DISTANCE_SENSOR_BUFFER_SIZE> echoSamples;
+
+DistanceSensorController::DistanceSensorController() {
+    // Triggers are low outputs, echoes are inputs without pullup
+    TriggerPort::data() &= ~TRIGGER_MASK;
+    TriggerPort::direction() |= TRIGGER_MASK;
+    EchoPort::direction() &= ~ECHO_MASK;
+    EchoPort::data() &= ~ECHO_MASK;
+
+    for (uint8_t i = 0; i < DISTANCE_SENSOR_COUNT; i++) {
+        triggerMasks[i] = BV(TRIGGER_PINS[i]);
+        echoMasks[i] = BV(ECHO_PINS[i]);
+        echoSensor[ECHO_PINS[i]] = i;
+        EchoPinChange::enable(ECHO_PINS[i]);
+    }
+
+    // Echo edges are timestamped from the timebase. One tick is 0.5 us and the
+    // counter wraps around after 32.8 ms. The sensor holds its echo high for
+    // about 38 ms when nothing is in range, which is longer than that, but
+    // measured echoes are bounded by DISTANCE_SENSOR_ECHO_TIMEOUT, which must
+    // stay below the wrap-around.
+    initializeTimebase();
+}
+
+// Schedules the next compare interrupt. Called with interrupts disabled.
+static inline void scheduleCompare(uint16_t at) {
+    OCR1B = at;
+    // Clear a match that may have happened before the new value was set
+    TIFR1 = BV(OCF1B);
+}
+
+// Schedules the next step of ping recovery. Called with interrupts disabled.
+static inline void scheduleRecoveryStep(uint16_t from) {
+    uint16_t step = pingRecoveryRemaining > RECOVERY_STEP_TICKS ?
+        RECOVERY_STEP_TICKS :
+        pingRecoveryRemaining;
+    pingRecoveryRemaining -= step;
+    scheduleCompare(from + step);
 }
 
-float DistanceSensorController::run() {
-    triggerState = !triggerState;
-    setData(triggerPort, triggerPin, triggerState);
+// Ends the ping of the current sensor, queues its result and schedules the
+// next ping. Sensors are pinged one at a time, so that they do not hear each
+// other's echoes.
+static inline void endPing(
+    uint16_t now,
+    DistanceStatus status,
+    uint16_t delay
+) {
+    EchoSample sample = { pingSensor, pingSequence, status, now, delay };
+    echoSamples.push(sample);
+    if (measurementTask >= 0) {
+        Scheduler::trigger(measurementTask);
+    }
 
-    return 0.3840*delay;
+    pingPhase = PING_RECOVERY;
+    pingSensor++;
+    if (pingSensor == DISTANCE_SENSOR_COUNT) {
+        pingSensor = 0;
+    }
+    pingRecoveryRemaining = pingRecoveryTicks;
+    scheduleRecoveryStep(now);
 }
 
-// TODO: This works only if echo is connected to Port C. Should support also
-// other pins.
-ISR(PCINT1_vect) {
-    bool isHigh = getData(echoPortStatic, echoPinStatic);
-    if (isHigh) {
-        // Start of measurement, reset values
-        counter = 0;
+// Starts a ping of the current sensor. Called with interrupts disabled.
+static inline void startPing(uint16_t now) {
+    // Echo must be low before the ping. If it is not, the sensor may still be
+    // holding the echo of the previous ping, and the ping is deferred. If the
+    // echo stays high, the sensor is broken or disconnected and the ping is
+    // skipped.
+    bool isEchoHigh = EchoPort::input() & echoMasks[pingSensor];
+    if (isEchoHigh && pingDeferrals < MAX_DEFERRALS) {
+        pingDeferrals++;
+        pingPhase = PING_RECOVERY;
+        pingRecoveryRemaining = 0;
+        scheduleCompare(now + DEFER_STEP_TICKS);
+        return;
     }
-    else {
-        // Measurement done, save measured delay
-        delay = counter;
+
+    pingDeferrals = 0;
+    pingSequence++;
+    if (isEchoHigh) {
+        endPing(now, DISTANCE_SENSOR_FAULT, 0);
+        return;
     }
+
+    TriggerPort::data() |= triggerMasks[pingSensor];
+    pingPhase = PING_TRIGGER;
+    isEchoStarted = false;
+    scheduleCompare(now + TRIGGER_TICKS);
 }
 
-ISR(TIMER0_OVF_vect) {
-    counter++;
-}
\ No newline at end of file
+void DistanceSensorController::start() {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        pingDeferrals = 0;
+        startPing(TCNT1);
+        TIMSK1 |= BV(OCIE1B);
+    }
+}
+
+void DistanceSensorController::setPingRecovery(uint32_t recovery) {
+    uint32_t ticks = TIMEBASE_US_TO_TICKS(recovery);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        pingRecoveryTicks = ticks;
+    }
+}
+
+void DistanceSensorController::setMeasurementTask(int8_t task) {
+    measurementTask = task;
+}
+
+bool DistanceSensorController::read(DistanceMeasurement& measurement) {
+    EchoSample sample;
+    if (!echoSamples.pop(sample)) {
+        return false;
+    }
+    ECHO_TRACE_RECORD(
+        Scheduler::getTicks(),
+        sample.sensor,
+        sample.status,
+        sample.delay
+    );
+
+    measurement.sensor = sample.sensor;
+    measurement.sequence = sample.sequence;
+    measurement.status = sample.status;
+    measurement.timestamp = sample.timestamp;
+    measurement.distance = ((uint32_t)sample.delay * MM_PER_TICK_Q16) >> 16;
+    if (
+        measurement.status == DISTANCE_VALID
+            && measurement.distance > DISTANCE_SENSOR_MAX_RANGE
+    ) {
+        measurement.status = DISTANCE_OUT_OF_RANGE;
+    }
+    return true;
+}
+
+uint16_t DistanceSensorController::getDroppedCount() {
+    return echoSamples.getDroppedCount();
+}
+
+uint16_t DistanceSensorController::getOverflowCount() {
+    return echoSamples.getOverflowCount();
+}
+
+// Handles echo edges. Only the echo of the sensor being pinged is measured,
+// edges from other sensors are ignored. Cost depends on the number of changed
+// pins, not on the number of sensors.
+static inline void handleEcho(uint16_t now, uint8_t rising, uint8_t falling) {
+    uint8_t changed = rising | falling;
+    for (uint8_t bit = 0; changed; bit++, changed >>= 1, rising >>= 1) {
+        if (!(changed & 1)) {
+            continue;
+        }
+
+        if (pingPhase == PING_RECOVERY || echoSensor[bit] != pingSensor) {
+            continue;
+        }
+
+        if (rising & 1) {
+            // Start of measurement, save timestamp
+            echoStart[bit] = now;
+            isEchoStarted = true;
+        }
+        else if (isEchoStarted) {
+            // Measurement done, queue measured delay. Unsigned arithmetic
+            // handles counter wrap-around.
+            endPing(now, DISTANCE_VALID, now - echoStart[bit]);
+        }
+    }
+}
+
+PIN_CHANGE_ISR(DISTANCE_SENSOR_ECHO_PORT, handleEcho)
+
+ISR(TIMER1_COMPB_vect) {
+    INSTRUMENT_ISR_BEGIN(PROBE_DISTANCE_SENSOR_TIMER_ISR);
+
+    uint16_t now = TCNT1;
+    switch (pingPhase) {
+        case PING_TRIGGER:
+            // Trigger pulse done, wait for the echo
+            TriggerPort::data() &= ~triggerMasks[pingSensor];
+            pingPhase = PING_ECHO;
+            scheduleCompare(now + ECHO_TIMEOUT_TICKS);
+            break;
+        case PING_ECHO:
+            // Echo timed out. If the echo never started, the sensor is not
+            // responding. If it started, no target was in range and the sensor
+            // is holding the echo high until its own timeout.
+            if (isEchoStarted) {
+                endPing(now, DISTANCE_OUT_OF_RANGE, 0);
+            }
+            else {
+                endPing(now, DISTANCE_SENSOR_FAULT, 0);
+            }
+            break;
+        case PING_RECOVERY:
+            if (pingRecoveryRemaining > 0) {
+                scheduleRecoveryStep(OCR1B);
+            }
+            else {
+                startPing(now);
+            }
+            break;
+    }
+
+    INSTRUMENT_ISR_END(PROBE_DISTANCE_SENSOR_TIMER_ISR);
+}
@@ -5,51 +5,106 @@
 
 #include <stdint.h>
 
+/// \enum DistanceStatus
+///
+/// Result of a single ping.
+enum DistanceStatus {
+    /// Target was detected, distance is valid
+    DISTANCE_VALID,
+    /// No target within range
+    DISTANCE_OUT_OF_RANGE,
+    /// Sensor did not respond, or its echo pin is stuck high
+    DISTANCE_SENSOR_FAULT
+};
+
+/// \struct DistanceMeasurement
+///
+/// Single distance measurement. Every ping produces one measurement, whether
+/// an echo was received or not.
+struct DistanceMeasurement {
+    /// Index of the sensor that made the measurement
+    uint8_t sensor;
+    /// Ping sequence number. Increases by one for each ping of any sensor, so
+    /// gaps show measurements that were dropped.
+    uint8_t sequence;
+    /// Ping result
+    DistanceStatus status;
+    /// Timer 1 value at the end of the ping
+    uint16_t timestamp;
+    /// Distance of target in units of millimeter. Only valid if status is
+    /// DISTANCE_VALID.
+    uint16_t distance;
+};
+
 /// \class DistanceSensorController
 ///
-/// Operates HC-SR04 ultrasound distance sensor.
+/// Operates one or more HC-SR04 ultrasound distance sensors. Sensor pins are
+/// defined in config.h. All echo pins are in the same port and are handled by
+/// a single pin change interrupt. Sensors are triggered in turn, so there must
+/// be only one instance of this class.
+///
+/// Pings are timed with the timer 1 compare unit B. Trigger pulse is ended by
+/// a compare match, and the next ping is started a fixed recovery time after
+/// the echo ends, or after the echo times out. Timed out pings are reported as
+/// out of range or as sensor faults, so dead sensors do not stall pinging.
+/// Pinging runs in interrupts independently of the main loop.
+///
+/// Measurements are queued by the echo interrupt in a ring buffer and read
+/// with read(). If measurements are not read fast enough, new ones are dropped.
 class DistanceSensorController {
 public:
     /// \brief
     ///    Initializes a new controller instance.
-    ///
-    /// \param triggerPort
-    ///     Port where sensor trigger is connected
-    /// \param triggerPin
-    ///     Pin where sensor trigger is connected
-    /// \param echoPort
-    ///     Port where sensor echo is connected
-    /// \param echoPin
-    ///     Pin where sensor echo is connected
-    DistanceSensorController(
-        Port triggerPort,
-        uint8_t triggerPin,
-        Port echoPort,
-        uint8_t echoPin
-    );
+    DistanceSensorController();
 
 public:
     /// \brief
-    ///    Instructs the controller to advance one step in sequence, essentially
-    ///    stepping the controller's clock.
+    ///    Starts pinging the sensors.
+    void start();
+
+    /// \brief
+    ///    Sets pause between end of a ping and start of the next one. Takes
+    ///    effect from the next ping. Initial value is
+    ///    DISTANCE_SENSOR_PING_RECOVERY.
+    ///
+    /// \param recovery
+    ///    Recovery time in microseconds. Must be less than 268 seconds.
+    void setPingRecovery(uint32_t recovery);
+
+    /// \brief
+    ///    Sets a scheduler task to trigger whenever a new measurement is
+    ///    queued. Must be called before start().
+    ///
+    /// \param task
+    ///    Task index, or -1 for none
+    void setMeasurementTask(int8_t task);
+
+    /// \brief
+    ///    Takes the oldest queued measurement. Call repeatedly to drain all
+    ///    measurements received since previous call.
+    ///
+    /// \param measurement
+    ///    Destination for the measurement
+    ///
+    /// \return
+    ///    If a measurement was available.
+    bool read(DistanceMeasurement& measurement);
+
+    /// \brief
+    ///    Returns number of measurements dropped because they were not read in
+    ///    time.
+    ///
+    /// \return
+    ///    Dropped measurement count
+    uint16_t getDroppedCount();
+
+    /// \brief
+    ///    Returns number of times the measurement queue has overflown.
+    ///    Consecutive drops are counted as a single overflow.
     ///
     /// \return
-    ///     Distance of target in units of centimeter if new reception is
-    ///     available, otherwise 0.
-    float run();
-
-private:
-    /// Port where sensor trigger is connected.
-    const Port triggerPort;
-    /// Pin where sensor trigger is connected.
-    const uint8_t triggerPin;
-    /// Port where sensor echo is connected.
-    const Port echoPort;
-    /// Pin where sensor echo is connected.
-    const uint8_t echoPin;
-
-    /// Trigger state. This is switched back and forth between run() calls.
-    bool triggerState;
+    ///    Overflow count
+    uint16_t getOverflowCount();
 };
 
 #endif
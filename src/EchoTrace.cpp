@@ -0,0 +1,39 @@
+#include "EchoTrace.h"
+
+#ifdef ECHO_TRACE
+
+EchoTrace echoTrace = { {}, 0, 0, 0xff };
+
+void echoTraceRecord(
+    uint16_t time,
+    uint8_t sensor,
+    uint8_t status,
+    uint16_t delay
+) {
+    if (echoTrace.remaining == 0) {
+        return;
+    }
+    if (echoTrace.remaining != 0xff) {
+        echoTrace.remaining--;
+    }
+
+    EchoTraceEntry& entry = echoTrace.entries[echoTrace.next];
+    entry.time = time;
+    entry.delay = delay;
+    entry.sensor = sensor;
+    entry.status = status;
+
+    echoTrace.next++;
+    if (echoTrace.next == ECHO_TRACE_LENGTH) {
+        echoTrace.next = 0;
+        echoTrace.isWrapped = true;
+    }
+}
+
+void echoTraceTrigger() {
+    if (echoTrace.remaining == 0xff) {
+        echoTrace.remaining = ECHO_TRACE_POST_TRIGGER;
+    }
+}
+
+#endif
@@ -0,0 +1,97 @@
+// Echo trace recording. Keeps the latest raw distance sensor pings in a ring
+// buffer, so that a sequence seen in the field can be replayed through the
+// firmware on the build host with host/replay.cpp.
+// Enabled by defining ECHO_TRACE in config.h. When disabled, all macros
+// compile to nothing.
+//
+// Recorded pings are kept in the global variable echoTrace, which can be read
+// from a debugger or a simulator memory dump. The buffer holds only the latest
+// ECHO_TRACE_LENGTH pings, so recording is frozen ECHO_TRACE_POST_TRIGGER
+// pings after presence is first detected. The trace then holds the pings that
+// led to the detection, which is what is needed to reproduce a false trigger.
+
+#ifndef _H_ECHO_TRACE
+#define _H_ECHO_TRACE
+
+#include "config.h"
+
+#include <stdint.h>
+
+#ifdef ECHO_TRACE
+
+static_assert(
+    ECHO_TRACE_LENGTH <= 255 && ECHO_TRACE_POST_TRIGGER < ECHO_TRACE_LENGTH,
+    "Echo trace is indexed with 8 bits and must be longer than the part "
+        "recorded after the trigger"
+);
+
+/// \struct EchoTraceEntry
+///
+/// Single recorded ping. All fields have fixed sizes, so that a memory dump can
+/// be decoded on the build host.
+struct EchoTraceEntry {
+    /// Scheduler time of reading the ping, in milliseconds
+    uint16_t time;
+    /// Echo length in timebase ticks. Only valid if status is DISTANCE_VALID.
+    uint16_t delay;
+    /// Index of the pinged sensor
+    uint8_t sensor;
+    /// Ping result, a DistanceStatus value
+    uint8_t status;
+};
+
+/// \struct EchoTrace
+///
+/// Recorded pings.
+struct EchoTrace {
+    /// Ring buffer of pings
+    EchoTraceEntry entries[ECHO_TRACE_LENGTH];
+    /// Index of the next entry to write. Once the buffer has wrapped around,
+    /// this is also the oldest entry.
+    uint8_t next;
+    /// If the buffer has wrapped around
+    uint8_t isWrapped;
+    /// Number of pings still recorded after trigger, or 0xff if not triggered
+    uint8_t remaining;
+};
+
+extern EchoTrace echoTrace;
+
+/// \brief
+///    Records a ping, unless recording is frozen.
+///
+/// \param time
+///    Scheduler time in milliseconds
+/// \param sensor
+///    Sensor index
+/// \param status
+///    Ping result, a DistanceStatus value
+/// \param delay
+///    Echo length in timebase ticks
+void echoTraceRecord(
+    uint16_t time,
+    uint8_t sensor,
+    uint8_t status,
+    uint16_t delay
+);
+
+/// \brief
+///    Freezes recording after ECHO_TRACE_POST_TRIGGER more pings. Only the
+///    first call has an effect.
+void echoTraceTrigger();
+
+/// Records a ping.
+#define ECHO_TRACE_RECORD(time, sensor, status, delay) \
+    echoTraceRecord((time), (sensor), (status), (delay))
+
+/// Marks presence detection.
+#define ECHO_TRACE_TRIGGER() echoTraceTrigger()
+
+#else
+
+#define ECHO_TRACE_RECORD(time, sensor, status, delay)
+#define ECHO_TRACE_TRIGGER()
+
+#endif
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef _H_FAST_RANDOM
+#define _H_FAST_RANDOM
+
+#include <stdint.h>
+
+/// \class FastRandom
+///
+/// Small and fast pseudorandom number generator, a 16 bit xorshift with
+/// period 2^16 - 1. Each number costs a few shifts and xors on 16 bit values,
+/// compared to the 32 bit arithmetic of avr-libc rand(). Sequence is fully
+/// determined by the seed.
+///
+/// Numbers below a limit are produced by multiplying and taking the high
+/// word, which avoids the software division needed by the modulo operator.
+class FastRandom {
+public:
+    /// \brief
+    ///    Initializes a new generator.
+    ///
+    /// \param seed
+    ///    Initial state. Zero is not a valid state and is replaced by 1.
+    FastRandom(uint16_t seed) {
+        setSeed(seed);
+    }
+
+public:
+    /// \brief
+    ///    Restarts the sequence from given seed.
+    ///
+    /// \param seed
+    ///    Initial state. Zero is not a valid state and is replaced by 1.
+    void setSeed(uint16_t seed) {
+        state = seed ? seed : 1;
+    }
+
+    /// \brief
+    ///    Returns next number in sequence.
+    ///
+    /// \return
+    ///    Random number between 1 and 65535
+    uint16_t next() {
+        state ^= state << 7;
+        state ^= state >> 9;
+        state ^= state << 8;
+        return state;
+    }
+
+    /// \brief
+    ///    Returns a random number below given limit.
+    ///
+    /// \param limit
+    ///    Upper limit, exclusive
+    ///
+    /// \return
+    ///    Random number between 0 and limit - 1, or 0 if limit is 0.
+    uint8_t below(uint8_t limit) {
+        return ((uint32_t)next() * limit) >> 16;
+    }
+
+private:
+    /// Generator state
+    uint16_t state;
+};
+
+#endif
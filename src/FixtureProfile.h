@@ -0,0 +1,63 @@
+#ifndef _H_FIXTURE_PROFILE
+#define _H_FIXTURE_PROFILE
+
+#include <stdint.h>
+
+/// \struct FixedChannel
+///
+/// Fixture channel that is held at a constant value.
+struct FixedChannel {
+    /// Channel offset from fixture start address
+    uint8_t offset;
+    /// Channel value
+    uint8_t value;
+};
+
+/// Value of FixtureProfile::fineOffset for fixtures with 8 bit dimmer
+#define NO_FINE_CHANNEL 0xff
+
+/// \struct FixtureProfile
+///
+/// Channel layout of a dmx fixture.
+struct FixtureProfile {
+    /// Offset of the flickering dimmer channel from fixture start address.
+    /// For 16 bit dimmers, this is the coarse channel.
+    uint8_t dimmerOffset;
+    /// Offset of the fine dimmer channel of 16 bit dimmers, or
+    /// NO_FINE_CHANNEL
+    uint8_t fineOffset;
+    /// Channels that are held at a constant value
+    const FixedChannel* fixedChannels;
+    /// Number of fixed channels
+    uint8_t fixedChannelCount;
+};
+
+/// Multichannel light used in testing. Dimmer is the first channel. Fifth
+/// channel has to be held at full value for the light to be on.
+static const FixedChannel TEST_FIXTURE_FIXED_CHANNELS[] = {
+    { 4, 255 }
+};
+static const FixtureProfile TEST_FIXTURE_PROFILE = {
+    0,
+    NO_FINE_CHANNEL,
+    TEST_FIXTURE_FIXED_CHANNELS,
+    sizeof(TEST_FIXTURE_FIXED_CHANNELS) / sizeof(FixedChannel)
+};
+
+/// Plain single channel dimmer.
+static const FixtureProfile DIMMER_PROFILE = {
+    0,
+    NO_FINE_CHANNEL,
+    0,
+    0
+};
+
+/// 16 bit dimmer, coarse channel first and fine channel second.
+static const FixtureProfile DIMMER_16BIT_PROFILE = {
+    0,
+    1,
+    0,
+    0
+};
+
+#endif
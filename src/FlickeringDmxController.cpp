@@ -0,0 +1,202 @@
+#include <stdint.h>
+
+#include "FlickeringDmxController.h"
+
+#include "DMXSerial.h"
+
+#include "GammaTable.h"
+#include "WaveformTables.h"
+
+#include <avr/pgmspace.h>
+
+// Tables of waveforms, indexed by Waveform. Noise has no table.
+static const int8_t* const WAVEFORM_TABLES[] = {
+    0,
+    WAVEFORM_CANDLE_TABLE,
+    WAVEFORM_FIRE_TABLE,
+    WAVEFORM_LIGHTNING_TABLE
+};
+
+// Fade level changes per step. Level is 0.16 fixed point, so full range is
+// covered in the configured time.
+static const uint16_t FADE_IN_STEP = FLICKER_FADE_IN_TIME >= EFFECT_PERIOD ?
+    0xffff / (FLICKER_FADE_IN_TIME / EFFECT_PERIOD) :
+    0xffff;
+static const uint16_t FADE_OUT_STEP = FLICKER_FADE_OUT_TIME >= EFFECT_PERIOD ?
+    0xffff / (FLICKER_FADE_OUT_TIME / EFFECT_PERIOD) :
+    0xffff;
+
+static_assert(
+    WAVEFORM_LENGTH == 256,
+    "Waveform playback assumes tables of 256 samples"
+);
+static_assert(
+    GAMMA_LENGTH == 256,
+    "Gamma correction assumes a table of 256 entries"
+);
+
+FlickeringDmxController::FlickeringDmxController() :
+    channelCount(0),
+    isFlickerEnabled(false),
+    fadeLevel(0),
+    random(FLICKER_RANDOM_SEED) {
+    // Further initialization
+    DMXSerial.init();
+}
+
+bool FlickeringDmxController::addFixture(
+    const FixtureProfile& profile,
+    uint16_t address,
+    uint8_t baseline,
+    uint8_t intensity,
+    Waveform waveform
+) {
+    if (channelCount == FLICKER_MAX_CHANNELS) {
+        return false;
+    }
+    bool isFine = profile.fineOffset != NO_FINE_CHANNEL;
+    if (
+        address + profile.dimmerOffset > DMXSERIAL_MAX
+            || (isFine && address + profile.fineOffset > DMXSERIAL_MAX)
+    ) {
+        // Channel is outside the dmx universe
+        return false;
+    }
+
+    channels[channelCount] = address + profile.dimmerOffset;
+    fineChannels[channelCount] = isFine ? address + profile.fineOffset : 0;
+    profiles[channelCount] = &profile;
+    baselines[channelCount] = baseline;
+    intensities[channelCount] = intensity;
+    values[channelCount] = baseline;
+    waveforms[channelCount] = waveform;
+    // Start from random phase, so that lights are not in sync
+    phases[channelCount] = random.next();
+
+    // Write through DMXSerial.write() once, so that the channels are included
+    // in transmitted frames
+    DMXSerial.write(channels[channelCount], 0);
+    if (isFine) {
+        DMXSerial.write(fineChannels[channelCount], 0);
+    }
+    output(DMXSerial.getBuffer(), channelCount);
+    channelCount++;
+
+    for (uint8_t i = 0; i < profile.fixedChannelCount; i++) {
+        const FixedChannel& fixed = profile.fixedChannels[i];
+        DMXSerial.write(address + fixed.offset, fixed.value);
+    }
+
+    // Written values are committed on next run()
+    return true;
+}
+
+void FlickeringDmxController::setFlickerEnabled(bool isFlickerEnabled) {
+    this->isFlickerEnabled = isFlickerEnabled;
+}
+
+void FlickeringDmxController::setSeed(uint16_t seed) {
+    random.setSeed(seed);
+}
+
+void FlickeringDmxController::run() {
+    // Ramp flicker towards enabled or disabled
+    if (isFlickerEnabled) {
+        fadeLevel = fadeLevel > 0xffff - FADE_IN_STEP ?
+            0xffff :
+            fadeLevel + FADE_IN_STEP;
+    }
+    else {
+        fadeLevel = fadeLevel < FADE_OUT_STEP ? 0 : fadeLevel - FADE_OUT_STEP;
+    }
+    int16_t fade = fadeLevel >> 8;
+
+    // Frames can be sent less often than the effect runs, for example in power
+    // save mode. Values computed before the previous ones were sent would
+    // never be seen, so they are not computed. Fade and waveforms still
+    // advance, so that their timing does not depend on the frame rate.
+    if (DMXSerial.isCommitPending()) {
+        if (fade) {
+            for (uint8_t i = 0; i < channelCount; i++) {
+                phases[i] += FLICKER_WAVEFORM_STEP;
+            }
+        }
+        return;
+    }
+
+    // Compute all channels
+    for (uint8_t i = 0; i < channelCount; i++) {
+        int16_t brightness = baselines[i];
+
+        if (fade) {
+            brightness += (flicker(i) * fade) >> 8;
+        }
+
+        if (brightness < 0) {
+            brightness = 0;
+        }
+        if (brightness > 255) {
+            brightness = 255;
+        }
+
+        values[i] = brightness;
+    }
+
+    // Write all channels at once. Channels were already written once in
+    // addFixture(), so they are included in transmitted frames and can be
+    // written to the buffer directly. Every channel in use is rewritten, fixed
+    // ones included, so the buffer need not hold the previous values.
+    uint8_t* buffer = DMXSerial.getRewriteBuffer();
+    for (uint8_t i = 0; i < channelCount; i++) {
+        output(buffer, i);
+        outputFixed(buffer, i);
+    }
+    DMXSerial.commit();
+}
+
+void FlickeringDmxController::output(uint8_t* buffer, uint8_t channel) {
+#ifdef GAMMA_CORRECTION
+    uint16_t level = pgm_read_word(&GAMMA_TABLE[values[channel]]);
+#else
+    uint16_t level = values[channel] << 8 | values[channel];
+#endif
+
+    buffer[channels[channel]] = level >> 8;
+    if (fineChannels[channel]) {
+        buffer[fineChannels[channel]] = level;
+    }
+}
+
+void FlickeringDmxController::outputFixed(uint8_t* buffer, uint8_t channel) {
+    const FixtureProfile& profile = *profiles[channel];
+    uint16_t address = channels[channel] - profile.dimmerOffset;
+    for (uint8_t i = 0; i < profile.fixedChannelCount; i++) {
+        const FixedChannel& fixed = profile.fixedChannels[i];
+        if (address + fixed.offset <= DMXSERIAL_MAX) {
+            buffer[address + fixed.offset] = fixed.value;
+        }
+    }
+}
+
+int16_t FlickeringDmxController::flicker(uint8_t channel) {
+    uint8_t intensity = intensities[channel];
+
+    if (waveforms[channel] == WAVEFORM_NOISE) {
+        return (int16_t)random.below(intensity) - intensity/2;
+    }
+
+    // Phase is 8.8 fixed point index to the table. Interpolate linearly
+    // between two neighboring samples, using 7 bits of the fraction so that
+    // all arithmetic fits in 16 bits.
+    const int8_t* table = WAVEFORM_TABLES[waveforms[channel]];
+    uint16_t phase = phases[channel];
+    uint8_t index = phase >> 8;
+    int16_t a = (int8_t)pgm_read_byte(table + index);
+    int16_t b = (int8_t)pgm_read_byte(table + (uint8_t)(index + 1));
+    int16_t sample = a + (((b - a) * (int16_t)((phase & 0xff) >> 1)) >> 7);
+
+    phases[channel] = phase + FLICKER_WAVEFORM_STEP;
+
+    // Sample is between -127 and 127, scale to +- intensity/2
+    return (sample * intensity) >> 8;
+}
@@ -0,0 +1,151 @@
+#ifndef _H_FLICKERING_DMX_CONTROLLER
+#define _H_FLICKERING_DMX_CONTROLLER
+
+#include "config.h"
+
+#include "FixtureProfile.h"
+#include "FastRandom.h"
+
+#include <stdint.h>
+
+/// \enum Waveform
+///
+/// Flicker waveforms. Noise is generated randomly on every step, the others
+/// are played back from tables stored in flash.
+enum Waveform {
+    WAVEFORM_NOISE,
+    WAVEFORM_CANDLE,
+    WAVEFORM_FIRE,
+    WAVEFORM_LIGHTNING
+};
+
+/// \class FlickeringDmxController
+///
+/// Transmits a basically constant but flickering sequence in the dimmer
+/// channels of several dmx fixtures. Other channels of the fixtures are held
+/// at constant values given by fixture profiles.
+///
+/// Each channel has its own waveform. Table waveforms are played back with
+/// 8.8 fixed point phase stepping and linear interpolation between samples.
+///
+/// Channel state is kept as separate arrays per property, so that a single
+/// pass over the arrays computes all channels. Computed values are written to
+/// the dmx buffer and committed together.
+class FlickeringDmxController {
+public:
+    /// \brief
+    ///    Initializes a new controller instance without any channels.
+    FlickeringDmxController();
+
+public:
+    /// \brief
+    ///    Adds a fixture. Its dimmer channel starts flickering and fixed
+    ///    channels are set to their values. Values are sent starting from
+    ///    next run().
+    ///
+    /// \param profile
+    ///    Fixture profile
+    /// \param address
+    ///    Dmx start address of the fixture
+    /// \param baseline
+    ///    Baseline brightness around which the flicker happens
+    /// \param intensity
+    ///    Flicker intensity
+    /// \param waveform
+    ///    Flicker waveform
+    ///
+    /// \return
+    ///    If the fixture was added. Otherwise, there was no room for more
+    ///    channels, or the dimmer channel is outside the dmx universe.
+    bool addFixture(
+        const FixtureProfile& profile,
+        uint16_t address,
+        uint8_t baseline,
+        uint8_t intensity,
+        Waveform waveform
+    );
+
+    /// \brief
+    ///    Sets if flicker is enabled. Flicker fades in and out over the times
+    ///    given in config.h.
+    ///
+    /// \param isFlickerEnabled
+    ///    If flicker is enabled
+    void setFlickerEnabled(bool isFlickerEnabled);
+
+    /// \brief
+    ///    Restarts the random sequence used for flicker. Same seed always
+    ///    produces the same output.
+    ///
+    /// \param seed
+    ///    Random seed
+    void setSeed(uint16_t seed);
+
+    /// \brief
+    ///    Instructs the controller to advance one step in sequence, essentially
+    ///    stepping the controller's clock. Fade and waveforms advance on
+    ///    every call. New values are computed and committed only if the
+    ///    values of the previous step have been taken into use by a dmx
+    ///    frame, so the effect never outputs faster than the dmx refresh
+    ///    rate. Never waits.
+    void run();
+
+private:
+    /// Dmx channel numbers. For 16 bit dimmers, these are coarse channels.
+    uint16_t channels[FLICKER_MAX_CHANNELS];
+    /// Dmx fine channel numbers of 16 bit dimmers, or 0 for 8 bit dimmers
+    uint16_t fineChannels[FLICKER_MAX_CHANNELS];
+    /// Fixture profile of each channel, for rewriting its fixed channels
+    const FixtureProfile* profiles[FLICKER_MAX_CHANNELS];
+    /// Baseline brightness of each channel
+    uint8_t baselines[FLICKER_MAX_CHANNELS];
+    /// Flicker intensity of each channel
+    uint8_t intensities[FLICKER_MAX_CHANNELS];
+    /// Current brightness of each channel, before gamma correction
+    uint8_t values[FLICKER_MAX_CHANNELS];
+    /// Waveform of each channel
+    uint8_t waveforms[FLICKER_MAX_CHANNELS];
+    /// Waveform playback phase of each channel
+    uint16_t phases[FLICKER_MAX_CHANNELS];
+    /// Number of channels in use
+    uint8_t channelCount;
+
+    /// If flicker if enabled.
+    bool isFlickerEnabled;
+    /// Current flicker strength, as 0.16 fixed point fraction
+    uint16_t fadeLevel;
+    /// Random source for flicker
+    FastRandom random;
+
+    /// \brief
+    ///    Writes brightness of a channel to the dmx buffer, through gamma
+    ///    correction.
+    ///
+    /// \param buffer
+    ///    Dmx buffer
+    /// \param channel
+    ///    Channel index
+    void output(uint8_t* buffer, uint8_t channel);
+
+    /// \brief
+    ///    Writes the fixed channels of the fixture of a channel to the dmx
+    ///    buffer. Channels outside the dmx universe are skipped.
+    ///
+    /// \param buffer
+    ///    Dmx buffer
+    /// \param channel
+    ///    Channel index
+    void outputFixed(uint8_t* buffer, uint8_t channel);
+
+    /// \brief
+    ///    Computes flicker of a channel and advances its waveform playback.
+    ///
+    /// \param channel
+    ///    Channel index
+    ///
+    /// \return
+    ///    Deviation from baseline brightness
+    int16_t flicker(uint8_t channel);
+};
+
+#endif
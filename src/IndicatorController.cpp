@@ -1,20 +1,18 @@
 #include <avr/io.h>
 
+#include "config.h"
+
 #include "AvrUtils.h"
 
 #include "IndicatorController.h"
 
-IndicatorController::IndicatorController(
-    Port port,
-    uint8_t pin,
-    uint16_t halfPeriod
-) :
-    port(port),
-    pin(pin),
+typedef Pin<INDICATOR_PORT, INDICATOR_PIN> IndicatorPin;
+
+IndicatorController::IndicatorController(uint16_t halfPeriod) :
     halfPeriod(halfPeriod),
     isLit(false),
     remainingPeriod(halfPeriod) {
-    setDataDirection(port, pin, true);    
+    IndicatorPin::setDataDirection(true);
 }
 
 void IndicatorController::run() {
@@ -23,7 +21,7 @@ void IndicatorController::run() {
     if (!remainingPeriod) {
         // Flip state and reset remaining period
         isLit = !isLit;
-        setData(port, pin, isLit);
+        IndicatorPin::setData(isLit);
         remainingPeriod = halfPeriod;
     }
 }
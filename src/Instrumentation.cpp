@@ -0,0 +1,43 @@
+#include "Instrumentation.h"
+
+#include <util/atomic.h>
+
+#ifdef INSTRUMENTATION
+
+volatile InstrumentationData instrumentationData;
+
+void instrumentationRecordLoop(uint16_t now, uint16_t nominalTicks) {
+    uint16_t period = now - instrumentationData.loopStart;
+    instrumentationData.loopStart = now;
+
+    // Skip the first loop, which has no previous start
+    static bool isFirst = true;
+    if (isFirst) {
+        isFirst = false;
+        return;
+    }
+
+    // Offset so that the middle bin starts half a bin below nominal period
+    int32_t offset = (int32_t)period - nominalTicks
+        + INSTRUMENTATION_BIN_WIDTH / 2
+        + (int32_t)INSTRUMENTATION_BIN_WIDTH * (INSTRUMENTATION_BINS / 2);
+    int32_t bin = offset < 0 ? 0 : offset / INSTRUMENTATION_BIN_WIDTH;
+    if (bin >= INSTRUMENTATION_BINS) {
+        bin = INSTRUMENTATION_BINS - 1;
+    }
+
+    if (instrumentationData.loopPeriods[bin] != 0xffff) {
+        instrumentationData.loopPeriods[bin]++;
+    }
+}
+
+void instrumentationLatencyBegin(uint16_t eventTimestamp) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint16_t now = TCNT1;
+        instrumentationData.latencyOffset = now - eventTimestamp;
+        instrumentationData.latencyStart = now;
+        instrumentationData.latencyState = LATENCY_ARMED;
+    }
+}
+
+#endif
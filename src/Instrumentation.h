@@ -0,0 +1,278 @@
+// Hot path instrumentation. Measures run time of interrupt service routines
+// and scheduler tasks, the period of the effect loop, the latency from a
+// distance measurement to the dmx frame reacting to it, and the share of time
+// the cpu sleeps, using the timebase.
+// Enabled by defining INSTRUMENTATION in config.h. When disabled, all macros
+// compile to nothing.
+//
+// Collected data is kept in the global variable instrumentationData, which can
+// be read from a debugger or a simulator memory dump. Durations are given in
+// cpu cycles, with resolution of TIMEBASE_PRESCALER cycles.
+
+#ifndef _H_INSTRUMENTATION
+#define _H_INSTRUMENTATION
+
+#include "config.h"
+
+#include "CpuLoadProbe.h"
+
+#include <stdint.h>
+
+/// \enum InstrumentationProbe
+///
+/// Measured code sections.
+enum InstrumentationProbe {
+    PROBE_PIN_CHANGE_ISR,
+    PROBE_DMX_TX_ISR,
+    PROBE_DMX_UDRE_ISR,
+    PROBE_DMX_TIMER_ISR,
+    PROBE_DISTANCE_SENSOR_TIMER_ISR,
+    PROBE_SCHEDULER_TICK_ISR,
+    /// Latency from end of ping to first data slot of the dmx frame carrying
+    /// the resulting values. A ping ends at the falling edge of its echo, or
+    /// at the echo timeout if it is out of range.
+    PROBE_SENSOR_TO_LIGHT_LATENCY,
+    /// Scheduler tasks, in order of registration
+    PROBE_TASK_FIRST,
+    PROBE_COUNT = PROBE_TASK_FIRST + SCHEDULER_MAX_TASKS
+};
+
+#ifdef INSTRUMENTATION
+
+#include "Timebase.h"
+
+/// \struct InstrumentationStats
+///
+/// Run time statistics of a single code section.
+struct InstrumentationStats {
+    /// Number of runs
+    uint32_t count;
+    /// Shortest run in cycles
+    uint32_t minCycles;
+    /// Longest run in cycles
+    uint32_t maxCycles;
+    /// Total run time in cycles, wrapping around
+    uint32_t totalCycles;
+};
+
+/// \enum LatencyState
+///
+/// Progress of a latency measurement through the dmx output.
+enum LatencyState {
+    /// No measurement in progress
+    LATENCY_IDLE,
+    /// Waiting for values to be committed
+    LATENCY_ARMED,
+    /// Waiting for the committed values to be taken into use
+    LATENCY_COMMITTED,
+    /// Waiting for the first data slot of the frame
+    LATENCY_SENDING
+};
+
+/// \struct InstrumentationData
+///
+/// All collected data.
+struct InstrumentationData {
+    /// Statistics of each probe, indexed by InstrumentationProbe
+    InstrumentationStats probes[PROBE_COUNT];
+
+    /// Histogram of effect loop periods. Bins are INSTRUMENTATION_BIN_WIDTH
+    /// ticks wide and centered on the nominal period, so that the middle bin
+    /// holds periods closest to nominal. First and last bin also hold all
+    /// periods beyond them.
+    uint16_t loopPeriods[INSTRUMENTATION_BINS];
+    /// Timebase value at start of previous effect loop
+    uint16_t loopStart;
+
+    /// State of the latency measurement, a LatencyState value
+    uint8_t latencyState;
+    /// Timebase value when latency measurement was started
+    uint16_t latencyStart;
+    /// Age of the measured event when latency measurement was started, in
+    /// timebase ticks
+    uint16_t latencyOffset;
+
+    /// Time the main loop has been awake, in timebase ticks. Interrupts that
+    /// wake the cpu are counted as sleep, their run time is found in the
+    /// probes. Active duty cycle is awakeTicks / (awakeTicks + sleepTicks).
+    /// Both are halved when their sum gets large, which keeps the ratio.
+    uint32_t awakeTicks;
+    /// Time the main loop has been asleep, in timebase ticks
+    uint32_t sleepTicks;
+    /// Timebase value when the main loop last fell asleep or woke up
+    uint16_t sleepEdge;
+};
+
+extern volatile InstrumentationData instrumentationData;
+
+/// \brief
+///    Adds a run to statistics of a probe. Inlined, so that interrupt service
+///    routines do not need to save registers for a function call.
+///
+/// \param probe
+///    Measured code section
+/// \param ticks
+///    Duration of the run in timebase ticks
+inline void instrumentationRecord(uint8_t probe, uint32_t ticks) {
+    volatile InstrumentationStats& stats = instrumentationData.probes[probe];
+    uint32_t cycles = ticks * TIMEBASE_PRESCALER;
+
+    if (stats.count == 0 || cycles < stats.minCycles) {
+        stats.minCycles = cycles;
+    }
+    if (cycles > stats.maxCycles) {
+        stats.maxCycles = cycles;
+    }
+    stats.totalCycles += cycles;
+    stats.count++;
+}
+
+/// \brief
+///    Adds a loop period to the histogram.
+///
+/// \param now
+///    Timebase value at the start of the loop
+/// \param nominalTicks
+///    Nominal loop period in timebase ticks
+void instrumentationRecordLoop(uint16_t now, uint16_t nominalTicks);
+
+/// \brief
+///    Starts measuring latency of reacting to an event. A measurement already
+///    in progress is discarded.
+///
+/// \param eventTimestamp
+///    Timebase value at the event. Must be less than a timebase period old.
+///    For distance measurements this is DistanceMeasurement::timestamp, the
+///    falling echo edge of valid pings and the echo timeout of out of range
+///    pings, so the timeout is not included in their latency.
+void instrumentationLatencyBegin(uint16_t eventTimestamp);
+
+/// \brief
+///    Ends latency measurement at the first data slot of a frame.
+///    Inlined, so that the interrupt service routine does not need to save
+///    registers for a function call.
+inline void instrumentationLatencyEnd() {
+    if (instrumentationData.latencyState != LATENCY_SENDING) {
+        return;
+    }
+
+    // The two legs are measured separately, so that the total may exceed a
+    // timebase period
+    uint16_t elapsed = TCNT1 - instrumentationData.latencyStart;
+    instrumentationRecord(
+        PROBE_SENSOR_TO_LIGHT_LATENCY,
+        (uint32_t)instrumentationData.latencyOffset + elapsed
+    );
+    instrumentationData.latencyState = LATENCY_IDLE;
+}
+
+/// \brief
+///    Marks the main loop falling asleep. Called with interrupts disabled.
+inline void instrumentationSleepBegin() {
+    uint16_t now = TCNT1;
+    instrumentationData.awakeTicks +=
+        (uint16_t)(now - instrumentationData.sleepEdge);
+    instrumentationData.sleepEdge = now;
+}
+
+/// \brief
+///    Marks the main loop waking up. Called with interrupts disabled.
+inline void instrumentationSleepEnd() {
+    uint16_t now = TCNT1;
+    instrumentationData.sleepTicks +=
+        (uint16_t)(now - instrumentationData.sleepEdge);
+    instrumentationData.sleepEdge = now;
+
+    if (
+        instrumentationData.awakeTicks + instrumentationData.sleepTicks
+            >= 0x80000000UL
+    ) {
+        instrumentationData.awakeTicks >>= 1;
+        instrumentationData.sleepTicks >>= 1;
+    }
+}
+
+/// Marks start of an interrupt service routine.
+#define INSTRUMENT_ISR_BEGIN(probe) \
+    CPU_LOAD_PROBE_BEGIN(); \
+    uint16_t _instrumentationStart = TCNT1
+
+/// Marks end of an interrupt service routine.
+#define INSTRUMENT_ISR_END(probe) \
+    instrumentationRecord( \
+        (probe), \
+        (uint16_t)(TCNT1 - _instrumentationStart) \
+    ); \
+    CPU_LOAD_PROBE_END()
+
+/// Marks start of a section running outside interrupts.
+#define INSTRUMENT_BEGIN(probe) \
+    uint16_t _instrumentationStart = getTimebaseTicks()
+
+/// Marks end of a section running outside interrupts.
+#define INSTRUMENT_END(probe) \
+    instrumentationRecord( \
+        (probe), \
+        (uint16_t)(getTimebaseTicks() - _instrumentationStart) \
+    )
+
+/// Marks start of the effect loop. Nominal period is given in milliseconds.
+#define INSTRUMENT_LOOP(nominalPeriod) \
+    instrumentationRecordLoop( \
+        getTimebaseTicks(), \
+        TIMEBASE_US_TO_TICKS((uint32_t)(nominalPeriod) * 1000) \
+    )
+
+/// Marks the main loop falling asleep. Called with interrupts disabled.
+#define INSTRUMENT_SLEEP_BEGIN() instrumentationSleepBegin()
+
+/// Marks the main loop waking up. Called with interrupts disabled.
+#define INSTRUMENT_SLEEP_END() instrumentationSleepEnd()
+
+/// Starts a latency measurement from an event with given timebase value.
+#define INSTRUMENT_LATENCY_BEGIN(eventTimestamp) \
+    instrumentationLatencyBegin(eventTimestamp)
+
+/// Marks values written after INSTRUMENT_LATENCY_BEGIN() as committed.
+#define INSTRUMENT_LATENCY_COMMIT() \
+    do { \
+        if (instrumentationData.latencyState == LATENCY_ARMED) { \
+            instrumentationData.latencyState = LATENCY_COMMITTED; \
+        } \
+    } while (0)
+
+/// Marks committed values as taken into use for the next frame. Called from
+/// interrupt service routines only.
+#define INSTRUMENT_LATENCY_SWAP() \
+    do { \
+        if (instrumentationData.latencyState == LATENCY_COMMITTED) { \
+            instrumentationData.latencyState = LATENCY_SENDING; \
+        } \
+    } while (0)
+
+/// Marks sending of a dmx slot. Measurement ends at slot 1, the first data
+/// slot of the frame. Called from interrupt service routines only.
+#define INSTRUMENT_LATENCY_SLOT(slot) \
+    do { \
+        if ((slot) == 1) { \
+            instrumentationLatencyEnd(); \
+        } \
+    } while (0)
+
+#else
+
+#define INSTRUMENT_ISR_BEGIN(probe) CPU_LOAD_PROBE_BEGIN()
+#define INSTRUMENT_ISR_END(probe) CPU_LOAD_PROBE_END()
+#define INSTRUMENT_BEGIN(probe)
+#define INSTRUMENT_END(probe)
+#define INSTRUMENT_LOOP(nominalPeriod)
+#define INSTRUMENT_SLEEP_BEGIN()
+#define INSTRUMENT_SLEEP_END()
+#define INSTRUMENT_LATENCY_BEGIN(eventTimestamp)
+#define INSTRUMENT_LATENCY_COMMIT()
+#define INSTRUMENT_LATENCY_SWAP()
+#define INSTRUMENT_LATENCY_SLOT(slot)
+
+#endif
+
+#endif
@@ -0,0 +1,13 @@
+#include "AvrUtils.h"
+
+#include "PowerReduction.h"
+
+#include <avr/io.h>
+
+void initializePowerReduction() {
+    // ADC must be disabled before it is powered down, or it stays enabled
+    ADCSRA &= ~BV(ADEN);
+    ACSR |= BV(ACD);
+
+    PRR |= BV(PRADC) | BV(PRSPI) | BV(PRTWI) | BV(PRTIM2);
+}
@@ -0,0 +1,16 @@
+// Power reduction. Modules the firmware does not use are switched off through
+// the Power Reduction Register, and the analog comparator is disabled.
+//
+// Sleep mode is chosen by the scheduler. Idle is the deepest mode that can be
+// used: all deeper modes stop the io clock, which halts the USART sending the
+// dmx stream and timers 0 and 1 keeping the scheduler tick and sensor timing.
+
+#ifndef _H_POWER_REDUCTION
+#define _H_POWER_REDUCTION
+
+/// \brief
+///    Switches off ADC, analog comparator, SPI, TWI and timer 2. Timers 0 and
+///    1 and USART 0 are left running.
+void initializePowerReduction();
+
+#endif
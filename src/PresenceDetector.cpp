@@ -0,0 +1,44 @@
+#include "PresenceDetector.h"
+
+PresenceDetector::PresenceDetector(
+    uint16_t enterDistance,
+    uint16_t exitDistance,
+    uint16_t enterDwell,
+    uint16_t exitDwell
+) :
+    enterDistance(enterDistance),
+    exitDistance(exitDistance),
+    enterDwell(enterDwell),
+    exitDwell(exitDwell),
+    present(false),
+    isDwelling(false),
+    dwellStart(0) {
+}
+
+bool PresenceDetector::update(uint16_t distance, uint16_t now) {
+    bool isBeyondThreshold = present ?
+        distance > exitDistance :
+        distance < enterDistance;
+
+    if (!isBeyondThreshold) {
+        isDwelling = false;
+        return present;
+    }
+
+    if (!isDwelling) {
+        isDwelling = true;
+        dwellStart = now;
+    }
+
+    // Unsigned arithmetic handles timestamp wrap-around
+    if ((uint16_t)(now - dwellStart) >= (present ? exitDwell : enterDwell)) {
+        present = !present;
+        isDwelling = false;
+    }
+
+    return present;
+}
+
+bool PresenceDetector::isPresent() {
+    return present;
+}
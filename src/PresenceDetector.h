@@ -0,0 +1,77 @@
+#ifndef _H_PRESENCE_DETECTOR
+#define _H_PRESENCE_DETECTOR
+
+#include <stdint.h>
+
+/// \class PresenceDetector
+///
+/// Decides from distance readings if someone is present. Uses separate
+/// thresholds for entering and exiting, and requires the distance to stay
+/// beyond the threshold for a dwell time before changing state. A single
+/// reading can therefore not flip the state, and readings near a threshold do
+/// not cause chatter.
+///
+/// Dwell is measured in time rather than in readings, so the detector can be
+/// updated whenever a new reading arrives, at any rate.
+class PresenceDetector {
+public:
+    /// \brief
+    ///    Initializes a new detector. Nobody is present initially.
+    ///
+    /// \param enterDistance
+    ///    Presence starts when distance is below this
+    /// \param exitDistance
+    ///    Presence ends when distance is above this. Should be greater than
+    ///    enterDistance.
+    /// \param enterDwell
+    ///    Time distance has to stay below enterDistance before presence
+    ///    starts, in the units of the update() timestamps
+    /// \param exitDwell
+    ///    Time distance has to stay above exitDistance before presence ends,
+    ///    in the units of the update() timestamps
+    PresenceDetector(
+        uint16_t enterDistance,
+        uint16_t exitDistance,
+        uint16_t enterDwell,
+        uint16_t exitDwell
+    );
+
+public:
+    /// \brief
+    ///    Updates the detector with a new distance reading.
+    ///
+    /// \param distance
+    ///    Current distance
+    /// \param now
+    ///    Time of the reading. Wraps around.
+    ///
+    /// \return
+    ///    If someone is present.
+    bool update(uint16_t distance, uint16_t now);
+
+    /// \brief
+    ///    Returns current state.
+    ///
+    /// \return
+    ///    If someone is present.
+    bool isPresent();
+
+private:
+    /// Presence starting distance
+    const uint16_t enterDistance;
+    /// Presence ending distance
+    const uint16_t exitDistance;
+    /// Time needed for starting presence
+    const uint16_t enterDwell;
+    /// Time needed for ending presence
+    const uint16_t exitDwell;
+
+    /// Current state
+    bool present;
+    /// If distance is currently beyond the threshold
+    bool isDwelling;
+    /// Time when distance went beyond the threshold
+    uint16_t dwellStart;
+};
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef _H_RING_BUFFER
+#define _H_RING_BUFFER
+
+#include <stdint.h>
+#include <util/atomic.h>
+
+/// Prevents the compiler from moving memory accesses across this point.
+#define COMPILER_MEMORY_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+/// \class RingBuffer
+///
+/// Lock-free single producer, single consumer queue. Intended for passing
+/// data from an interrupt service routine (producer) to the main program
+/// (consumer) without disabling interrupts.
+///
+/// Head is written only by the producer and tail only by the consumer. Both
+/// are single bytes, so they are read and written atomically. An item is
+/// fully written before head is advanced, and fully read before tail is
+/// advanced, so the other side never sees a partially written item.
+///
+/// If the producer finds the buffer full, the new item is dropped. Dropped
+/// items and overflow events (runs of consecutive drops) are counted.
+///
+/// \tparam T
+///    Item type
+/// \tparam size
+///    Capacity in items. Must be a power of two, at most 128.
+template<typename T, uint8_t size>
+class RingBuffer {
+    static_assert(
+        size > 0 && size <= 128 && (size & (size - 1)) == 0,
+        "Ring buffer size must be a power of two, at most 128"
+    );
+
+public:
+    /// \brief
+    ///    Initializes an empty buffer.
+    RingBuffer() :
+        head(0),
+        tail(0),
+        droppedCount(0),
+        overflowCount(0),
+        isOverflowing(false) {
+    }
+
+public:
+    /// \brief
+    ///    Adds an item. Must be called by the producer only.
+    ///
+    /// \param item
+    ///    Item to add
+    ///
+    /// \return
+    ///    If item was added. Otherwise, buffer was full and item was dropped.
+    bool push(const T& item) {
+        uint8_t headCopy = head;
+        if ((uint8_t)(headCopy - tail) == size) {
+            if (droppedCount != 0xffff) {
+                droppedCount++;
+            }
+            if (!isOverflowing && overflowCount != 0xffff) {
+                overflowCount++;
+            }
+            isOverflowing = true;
+            return false;
+        }
+
+        items[headCopy & (size - 1)] = item;
+        COMPILER_MEMORY_BARRIER();
+        head = headCopy + 1;
+        isOverflowing = false;
+        return true;
+    }
+
+    /// \brief
+    ///    Removes the oldest item. Must be called by the consumer only.
+    ///
+    /// \param item
+    ///    Destination for the removed item
+    ///
+    /// \return
+    ///    If an item was available.
+    bool pop(T& item) {
+        uint8_t tailCopy = tail;
+        if (tailCopy == head) {
+            return false;
+        }
+        // Item must not be read before head shows it was written
+        COMPILER_MEMORY_BARRIER();
+
+        item = items[tailCopy & (size - 1)];
+        COMPILER_MEMORY_BARRIER();
+        tail = tailCopy + 1;
+        return true;
+    }
+
+    /// \brief
+    ///    Returns number of items dropped because the buffer was full.
+    ///
+    /// \return
+    ///    Dropped item count. Saturates at maximum value.
+    uint16_t getDroppedCount() {
+        uint16_t count;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            count = droppedCount;
+        }
+        return count;
+    }
+
+    /// \brief
+    ///    Returns number of times the buffer has overflown. Consecutive drops
+    ///    are counted as a single overflow.
+    ///
+    /// \return
+    ///    Overflow count. Saturates at maximum value.
+    uint16_t getOverflowCount() {
+        uint16_t count;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            count = overflowCount;
+        }
+        return count;
+    }
+
+private:
+    /// Stored items
+    T items[size];
+    /// Count of items pushed, wrapping around. Written by producer only.
+    volatile uint8_t head;
+    /// Count of items popped, wrapping around. Written by consumer only.
+    volatile uint8_t tail;
+
+    /// Number of dropped items. Written by producer only.
+    volatile uint16_t droppedCount;
+    /// Number of overflows. Written by producer only.
+    volatile uint16_t overflowCount;
+    /// If previous push was dropped. Used by producer only.
+    bool isOverflowing;
+};
+
+#endif
@@ -0,0 +1,177 @@
+#include "config.h"
+
+#include "AvrUtils.h"
+
+#include "Scheduler.h"
+
+#include "Instrumentation.h"
+#include "Timebase.h"
+
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+// Prescaler and compare value for 1 ms tick
+#define TICK_PRESCALER 64
+#define TICK_COMPARE_VALUE ((F_CPU / TICK_PRESCALER / 1000) - 1)
+
+static_assert(
+    SCHEDULER_MAX_TASKS <= 8,
+    "Triggered tasks are kept in an 8 bit mask"
+);
+
+// Longest task budget in ticks. Run times are measured with the timebase,
+// which wraps around after 32.8 ms. A run that has wrapped lasts at least
+// TIMEBASE_WRAP_TICKS ticks, and a run that lasts that many ticks is longer
+// than any budget.
+#define MAX_BUDGET 30
+#define TIMEBASE_WRAP_TICKS 32
+
+static_assert(
+    TIMEBASE_US_TO_TICKS((uint32_t)TIMEBASE_WRAP_TICKS * 1000) <= 0x10000
+        && TIMEBASE_WRAP_TICKS - 1 > MAX_BUDGET,
+    "Task run time must be measurable with the timebase up to the budget"
+);
+
+// Ticks since startup. Written only by the timer interrupt.
+volatile uint16_t ticks = 0;
+
+// Tasks triggered to run at once, as a bit mask of task indices
+volatile uint8_t triggeredTasks = 0;
+
+Scheduler::Scheduler() :
+    taskCount(0) {
+    initializeTimebase();
+    initializeTimer0(PSV_64, CTC, TOP_OCRA);
+    OCR0A = TICK_COMPARE_VALUE;
+    // Enable interrupt on compare match
+    TIMSK0 |= BV(OCIE0A);
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+}
+
+int8_t Scheduler::addTask(
+    TaskFunction function,
+    uint16_t period,
+    uint16_t budget
+) {
+    if (taskCount == SCHEDULER_MAX_TASKS) {
+        return -1;
+    }
+
+    Task& task = tasks[taskCount];
+    task.function = function;
+    task.period = period;
+    if (budget > MAX_BUDGET) {
+        budget = MAX_BUDGET;
+    }
+    task.budget = TIMEBASE_US_TO_TICKS((uint32_t)budget * 1000);
+    task.nextRelease = getTicks();
+    task.overrunCount = 0;
+
+    return taskCount++;
+}
+
+void Scheduler::run() {
+    uint8_t taskMask = BV(taskCount) - 1;
+
+    while (true) {
+        for (uint8_t i = 0; i < taskCount; i++) {
+            runIfDue(tasks[i]);
+        }
+
+        // Sleep until next interrupt, unless a tick has happened already. Any
+        // interrupt wakes the cpu, so this loop can run several times per
+        // tick. Interrupts are enabled only right before sleep_cpu, which
+        // guarantees that the tick or a trigger cannot be missed.
+        uint16_t lastTicks = getTicks();
+        cli();
+        if (ticks == lastTicks && !(triggeredTasks & taskMask)) {
+            INSTRUMENT_SLEEP_BEGIN();
+            sleep_enable();
+            sei();
+            sleep_cpu();
+            sleep_disable();
+            cli();
+            INSTRUMENT_SLEEP_END();
+        }
+        sei();
+    }
+}
+
+uint16_t Scheduler::getOverrunCount(int8_t task) {
+    if (task < 0 || task >= taskCount) {
+        return 0;
+    }
+
+    return tasks[task].overrunCount;
+}
+
+void Scheduler::trigger(int8_t task) {
+    if (task < 0 || task >= SCHEDULER_MAX_TASKS) {
+        return;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        triggeredTasks |= BV(task);
+    }
+}
+
+uint16_t Scheduler::getTicks() {
+    uint16_t ticksCopy;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ticksCopy = ticks;
+    }
+    return ticksCopy;
+}
+
+void Scheduler::runIfDue(Task& task) {
+    uint8_t index = &task - tasks;
+    uint8_t mask = BV(index);
+    uint16_t start = getTicks();
+
+    if (triggeredTasks & mask) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            triggeredTasks &= ~mask;
+        }
+        // Continue periodic releases from this run
+        task.nextRelease = start;
+    }
+    // Signed difference handles tick counter wrap-around
+    else if ((int16_t)(start - task.nextRelease) < 0) {
+        return;
+    }
+
+    INSTRUMENT_BEGIN(PROBE_TASK_FIRST + index);
+    uint16_t runStart = getTimebaseTicks();
+    task.function();
+    uint16_t runTime = getTimebaseTicks() - runStart;
+    INSTRUMENT_END(PROBE_TASK_FIRST + index);
+
+    // Runs longer than a timebase period are over any budget, and their
+    // timebase difference has wrapped around
+    uint16_t end = getTicks();
+    bool isOverrun = runTime > task.budget
+        || (uint16_t)(end - start) >= TIMEBASE_WRAP_TICKS;
+
+    // Next release is relative to previous release, so that the period does
+    // not drift. If the task is late by more than a period, the missed
+    // releases are skipped but phase is kept.
+    task.nextRelease += task.period;
+    while ((int16_t)(end - task.nextRelease) >= 0) {
+        task.nextRelease += task.period;
+        isOverrun = true;
+    }
+
+    if (isOverrun && task.overrunCount != 0xffff) {
+        task.overrunCount++;
+    }
+}
+
+ISR(TIMER0_COMPA_vect) {
+    INSTRUMENT_ISR_BEGIN(PROBE_SCHEDULER_TICK_ISR);
+
+    ticks++;
+
+    INSTRUMENT_ISR_END(PROBE_SCHEDULER_TICK_ISR);
+}
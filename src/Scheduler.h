@@ -0,0 +1,109 @@
+#ifndef _H_SCHEDULER
+#define _H_SCHEDULER
+
+#include "config.h"
+
+#include <stdint.h>
+
+/// \class Scheduler
+///
+/// Cooperative scheduler running tasks with fixed periods. Time is kept by a
+/// 1 ms tick generated by timer 0. Between ticks, the cpu is put to idle
+/// sleep. Idle is the deepest sleep mode that keeps the io clock, and with it
+/// the timers and the USART, running.
+///
+/// Task releases are computed from the previous release, not from the time
+/// the task was actually run, so periods do not drift. If a task runs longer
+/// than its budget, or is still due after it has run, an overrun is counted
+/// for the task. Run time is measured with the timebase, so an overrun is
+/// detected as soon as the budget is exceeded, not a full tick later.
+///
+/// A task can also be triggered to run at once, for example from an interrupt
+/// when new data arrives. Periodic releases of a triggered task continue one
+/// period after the triggered run.
+class Scheduler {
+public:
+    /// Function run by a task
+    typedef void (*TaskFunction)();
+
+    /// \brief
+    ///    Initializes the scheduler and starts the tick timer.
+    Scheduler();
+
+public:
+    /// \brief
+    ///    Registers a new task. Tasks that are due at the same tick are run in
+    ///    the order they were added.
+    ///
+    /// \param function
+    ///    Function to run
+    /// \param period
+    ///    Task period in ticks
+    /// \param budget
+    ///    Longest allowed duration of a single run of the task in ticks. Larger
+    ///    values are limited to 30, which is just below the timebase period.
+    ///
+    /// \return
+    ///    Task index, or -1 if the task table is full.
+    int8_t addTask(TaskFunction function, uint16_t period, uint16_t budget);
+
+    /// \brief
+    ///    Runs the tasks. Never returns.
+    void run();
+
+    /// \brief
+    ///    Returns number of overruns of a task.
+    ///
+    /// \param task
+    ///    Task index, as returned by addTask()
+    ///
+    /// \return
+    ///    Overrun count. Saturates at maximum value.
+    uint16_t getOverrunCount(int8_t task);
+
+    /// \brief
+    ///    Triggers a task to run as soon as possible, even if it is not due.
+    ///    Can be called from interrupt service routines.
+    ///
+    /// \param task
+    ///    Task index, as returned by addTask()
+    static void trigger(int8_t task);
+
+    /// \brief
+    ///    Returns current time.
+    ///
+    /// \return
+    ///    Ticks since scheduler was initialized, wrapping around.
+    static uint16_t getTicks();
+
+private:
+    /// \struct Task
+    ///
+    /// State of a single registered task
+    struct Task {
+        /// Function to run
+        TaskFunction function;
+        /// Period in ticks
+        uint16_t period;
+        /// Budget in timebase ticks
+        uint16_t budget;
+        /// Tick when task is run next
+        uint16_t nextRelease;
+        /// Number of detected overruns
+        uint16_t overrunCount;
+    };
+
+    /// Registered tasks
+    Task tasks[SCHEDULER_MAX_TASKS];
+    /// Number of registered tasks
+    uint8_t taskCount;
+
+    /// \brief
+    ///    Runs task if it is due and updates its next release.
+    ///
+    /// \param task
+    ///    Task to run
+    void runIfDue(Task& task);
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "StackMonitor.h"
+
+#include <avr/io.h>
+
+#ifdef __AVR__
+
+// Provided by the linker: end of static variables and initial stack pointer
+extern uint8_t _end;
+extern uint8_t __stack;
+
+// Paints memory from end of static variables up to the stack top. Placed in
+// section .init1, so it runs right after reset, before static variables are
+// initialized. Written in assembly, because at this point the compiler's
+// assumptions (zero register, stack frame) do not hold yet.
+void paintStack() __attribute__((naked, used, section(".init1")));
+
+void paintStack() {
+    __asm__ __volatile__(
+        "    ldi r30, lo8(_end)\n"
+        "    ldi r31, hi8(_end)\n"
+        "    ldi r24, %[pattern]\n"
+        "    ldi r25, hi8(__stack)\n"
+        "    rjmp 2f\n"
+        "1:  st Z+, r24\n"
+        "2:  cpi r30, lo8(__stack)\n"
+        "    cpc r31, r25\n"
+        "    brlo 1b\n"
+        "    breq 1b\n"
+        :
+        : [pattern] "M" (STACK_PAINT_PATTERN)
+    );
+}
+
+uint16_t getStackUnusedBytes() {
+    const uint8_t* p = &_end;
+    while (p <= &__stack && *p == STACK_PAINT_PATTERN) {
+        p++;
+    }
+    return p - &_end;
+}
+
+uint16_t getStackMaxUsedBytes() {
+    return (&__stack - &_end + 1) - getStackUnusedBytes();
+}
+
+#else
+
+// Host build has no painted stack
+
+uint16_t getStackUnusedBytes() {
+    return 0;
+}
+
+uint16_t getStackMaxUsedBytes() {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,29 @@
+// Stack usage monitoring. At startup, before any other code runs, all memory
+// between the end of static variables and the top of the stack is painted
+// with a known pattern. Stack growth overwrites the pattern, so the deepest
+// point the stack has ever reached can be found by scanning for it.
+
+#ifndef _H_STACK_MONITOR
+#define _H_STACK_MONITOR
+
+#include <stdint.h>
+
+/// Pattern painted over unused memory
+#define STACK_PAINT_PATTERN 0xc5
+
+/// \brief
+///    Returns number of bytes between static variables and stack that have
+///    never been used. This is the remaining margin for stack growth.
+///
+/// \return
+///    Never used bytes
+uint16_t getStackUnusedBytes();
+
+/// \brief
+///    Returns the largest stack size reached since startup (high-water mark).
+///
+/// \return
+///    Maximum stack usage in bytes
+uint16_t getStackMaxUsedBytes();
+
+#endif
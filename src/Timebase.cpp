@@ -0,0 +1,22 @@
+#include "AvrUtils.h"
+
+#include "Timebase.h"
+
+#include <util/atomic.h>
+
+static_assert(
+    TIMEBASE_PRESCALER == 8,
+    "Prescaler passed to initializeTimer1() must match TIMEBASE_PRESCALER"
+);
+
+void initializeTimebase() {
+    initializeTimer1(PSV_8, NORMAL, TOP_00FF);
+}
+
+uint16_t getTimebaseTicks() {
+    uint16_t ticks;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ticks = TCNT1;
+    }
+    return ticks;
+}
@@ -0,0 +1,37 @@
+// Shared time base. Timer 1 runs free with a fixed prescaler and is used for
+// timestamping and for timing events with its compare units. Counter value is
+// never modified, so all users can share the timer.
+
+#ifndef _H_TIMEBASE
+#define _H_TIMEBASE
+
+#include "config.h"
+
+#include <avr/io.h>
+#include <stdint.h>
+
+/// Prescaler of timer 1
+#define TIMEBASE_PRESCALER 8
+
+/// Number of timebase ticks in a second
+#define TIMEBASE_TICKS_PER_SECOND (F_CPU / TIMEBASE_PRESCALER)
+
+/// Converts a duration given in microseconds to timebase ticks
+#define TIMEBASE_US_TO_TICKS(us) \
+    ((uint32_t)(us) * (F_CPU / 1000000UL) / TIMEBASE_PRESCALER)
+
+/// \brief
+///    Starts timer 1 in normal mode. Safe to call more than once.
+void initializeTimebase();
+
+/// \brief
+///    Reads current timebase value. Reading 16 bit timer registers uses a
+///    temporary register shared by all of them, so reading outside interrupts
+///    must not be interrupted. Interrupt service routines can read TCNT1
+///    directly.
+///
+/// \return
+///    Timer 1 counter value
+uint16_t getTimebaseTicks();
+
+#endif
@@ -1,16 +1,205 @@
 // This is the configuration file. Ideally, any configuration and calibration
 // of the device should be done by changing this file only.
 
-// Needed by util/delay.h
+// CPU clock frequency in Hz. Timer 0 scheduler tick, timer 1 timebase and
+// USART baud rates are derived from it.
 #define F_CPU 16000000UL
 
-// Delay between two executions of main loop, given in millisecond.
-#define LOOP_DELAY 25
+// Pin where the indicator light is connected.
+#define INDICATOR_PORT C
+#define INDICATOR_PIN 0
 
-// Baseline brightness of the light. Given as value between 0 and 255.
-#define LIGHT_BRIGHTNESS_BASELINE 115
+// Number of distance sensors. Sensors are pinged in turn.
+#define DISTANCE_SENSOR_COUNT 1
+// Pins where the distance sensor triggers and echoes are connected, listed in
+// sensor order. All triggers must be in the same port, and all echoes must be
+// in the same port.
+#define DISTANCE_SENSOR_TRIGGER_PORT C
+#define DISTANCE_SENSOR_TRIGGER_PINS { 2 }
+#define DISTANCE_SENSOR_ECHO_PORT C
+#define DISTANCE_SENSOR_ECHO_PINS { 3 }
+
+// Maximum number of tasks registered to the scheduler.
+#define SCHEDULER_MAX_TASKS 4
+
+// Periods of the tasks run by the scheduler, given in millisecond. Distance
+// sensor pings run independently of the distance sensor task, which only
+// collects the measurements.
+#define INDICATOR_PERIOD 25
+#define DISTANCE_SENSOR_PERIOD 25
+#define EFFECT_PERIOD 25
+
+// If defined, a finished distance measurement triggers the distance sensor
+// task at once, and a change of presence triggers the effect task at once.
+// Otherwise, both wait for their next periodic run.
+#define SENSOR_EVENT_DRIVEN
+
+// Time budgets of the tasks, given in millisecond. If a task runs longer, an
+// overrun is counted for it.
+#define INDICATOR_BUDGET 1
+#define DISTANCE_SENSOR_BUDGET 1
+#define EFFECT_BUDGET 1
+
+// Dmx start addresses of the lights. All lights use the same fixture profile,
+// which is one of the profiles defined in FixtureProfile.h.
+#define FIXTURE_ADDRESSES { 1 }
+#define FIXTURE_PROFILE TEST_FIXTURE_PROFILE
+// Maximum number of flickering channels.
+#define FLICKER_MAX_CHANNELS 4
+
+// Baseline brightness of the light. Given as value between 0 and 255. With
+// gamma correction, this is perceptual brightness. 177 gives the same light
+// output as linear value 115.
+#define LIGHT_BRIGHTNESS_BASELINE 177
 // Flicker intensity of the light. Given in same units as
-// LIGHT_BRIGHTNESS_BASELINE.
-#define LIGHT_FLICKER_INTENSITY 60
-// Distance threshold for starting the flicker. Given in units of centimeter.
-#define DISTANCE_THRESHOLD 250
\ No newline at end of file
+// LIGHT_BRIGHTNESS_BASELINE. With gamma correction, 42 swings the light output
+// between linear values 87 and 146, like intensity 60 around linear baseline
+// 115.
+#define LIGHT_FLICKER_INTENSITY 42
+
+// Gamma correction. When defined, brightness values are mapped to light output
+// through a table generated by tools/generate-gamma.cpp, and 16 bit fixtures
+// get the full resolution of the table. Comment out to send brightness values
+// as such.
+#define GAMMA_CORRECTION
+// Flicker waveform, one of the values of Waveform enum in
+// FlickeringDmxController.h.
+#define FLICKER_WAVEFORM WAVEFORM_CANDLE
+// Speed of waveform playback. Given as fraction of sample advanced per effect
+// step, in units of 1/256.
+#define FLICKER_WAVEFORM_STEP 256
+
+// Seed of the random sequence used for flicker. Same seed always produces the
+// same flicker.
+#define FLICKER_RANDOM_SEED 0x2019
+
+// Distance thresholds for starting and stopping the flicker. Given in units of
+// centimeter. Exit threshold should be greater than enter threshold.
+#define DISTANCE_THRESHOLD_ENTER 250
+#define DISTANCE_THRESHOLD_EXIT 300
+// Time distance has to stay beyond a threshold before flicker is started or
+// stopped. Given in millisecond.
+#define PRESENCE_ENTER_DWELL 100
+#define PRESENCE_EXIT_DWELL 1000
+
+// Time it takes for flicker to fade fully in or out. Given in millisecond.
+#define FLICKER_FADE_IN_TIME 300
+#define FLICKER_FADE_OUT_TIME 2000
+
+// Conversion factor from echo delay to target distance, given in millimeter
+// per millisecond of echo delay. Nominal value based on speed of sound is 172.
+// The value used here is the calibration the device has been using so far.
+#define DISTANCE_SENSOR_MM_PER_MS 240
+
+// Number of distance measurements that can be queued between two runs of the
+// distance sensor task. Must be a power of two.
+#define DISTANCE_SENSOR_BUFFER_SIZE 4
+
+// Length of the distance sensor trigger pulse, given in microseconds. HC-SR04
+// requires at least 10 us.
+#define DISTANCE_SENSOR_TRIGGER_LENGTH 12
+// Maximum time from end of trigger to end of echo, given in microseconds. If
+// the echo has not ended by then, the ping is reported as out of range, or as
+// a sensor fault if the echo never started. Must be less than 32768.
+#define DISTANCE_SENSOR_ECHO_TIMEOUT 30000
+// Longest distance reported as valid, given in millimeters. Longer echoes are
+// reported as out of range.
+#define DISTANCE_SENSOR_MAX_RANGE 4000
+// Time after which distance is considered unknown if no sensor reports a
+// valid distance or out of range, given in milliseconds.
+#define DISTANCE_SENSOR_STALE_TIME 500
+// Pause between end of an echo and the next ping, given in microseconds. Lets
+// the sensor recover and stray echoes of the previous ping fade out.
+#define DISTANCE_SENSOR_PING_RECOVERY 10000
+// Longest wait for the echo to go low before a ping, given in microseconds.
+// HC-SR04 holds its echo high for about 38 ms when no target is in range,
+// which can outlast the echo timeout and the ping recovery. The ping is
+// deferred while the echo is high, and reported as a sensor fault only if the
+// echo is still high after this time.
+#define DISTANCE_SENSOR_STUCK_ECHO_TIME 30000
+
+// Distance filter sliding median window, given in number of samples. Must be
+// odd. Value 1 disables the median.
+#define DISTANCE_FILTER_WINDOW 5
+// Distance filter exponential moving average weight. Each new sample has
+// weight 1/2^DISTANCE_FILTER_EMA_SHIFT. Value 0 disables the average.
+#define DISTANCE_FILTER_EMA_SHIFT 1
+// Distance filter outlier rejection. Samples deviating from the filtered
+// distance more than the limit are rejected, unless there are more than
+// DISTANCE_FILTER_OUTLIER_COUNT of them in a row. Limit is given in
+// millimeter. Value 0 disables outlier rejection.
+#define DISTANCE_FILTER_OUTLIER_LIMIT 1000
+#define DISTANCE_FILTER_OUTLIER_COUNT 2
+// Number of pings in a row without a target after which the distance filter
+// forgets the previous target, so that the next one is not rejected as its
+// outlier. A single missed echo of a target still in range does not reset the
+// filter.
+#define DISTANCE_FILTER_RESET_COUNT 3
+
+// Number of DMX channels supported, between 1 and 512. DMX buffers take one
+// byte per channel (two in double buffer mode), so this should be just high
+// enough for the highest channel used.
+#define DMX_UNIVERSE_SIZE 8
+
+// Target DMX refresh rate, given in frames per second. Frames are padded with
+// idle time to reach the rate. Value 0 sends frames back to back. Frames are
+// always padded to the shortest legal length.
+#define DMX_REFRESH_RATE 0
+
+// Power save mode. When nobody has been present for POWER_SAVE_DELAY
+// milliseconds (at most 65535), dmx refresh rate and distance sensor ping rate
+// are lowered. Normal rates are restored as soon as any sensor sees a target
+// closer than the presence entering threshold.
+#define POWER_SAVE_DELAY 30000
+// Dmx refresh rate in power save mode, given in frames per second
+#define POWER_SAVE_DMX_REFRESH_RATE 10
+// Pause between distance sensor pings in power save mode, given in
+// microseconds
+#define POWER_SAVE_PING_RECOVERY 200000
+// Minimal DMX frame mode. When defined, only channels up to the highest one
+// written are sent. When not defined, at least 32 channels, or the whole
+// universe if it is smaller, are always sent. Comment out to disable.
+//#define DMX_MINIMAL_FRAME
+
+// DMX break generation. When defined, the break and mark after break are timed
+// with timer 1 while the USART is disabled. Their lengths are exact and the
+// USART baud rate is not changed for every frame. Comment out to send the
+// break as a zero byte at lower baud rate instead.
+#define DMX_TIMER_BREAK
+// Lengths of timed break and mark after break, given in microseconds. The
+// standard requires at least 92 us and 12 us.
+#define DMX_BREAK_LENGTH 100
+#define DMX_MAB_LENGTH 16
+
+// Double buffering of DMX data. When defined, values written to DMX channels
+// are sent only after a commit, and every frame carries a consistent set of
+// values. Costs two more DMX buffers worth of memory. Comment out to disable.
+#define DMX_DOUBLE_BUFFER
+
+// Optional cpu load probe. When defined, the probe pin is driven high for the
+// duration of every interrupt service routine, so that the share of cpu time
+// spent in interrupts can be read as the duty cycle of the pin using an
+// oscilloscope or a logic analyzer. Comment out to disable.
+//#define CPU_LOAD_PROBE_PORT PORTB
+//#define CPU_LOAD_PROBE_DDR DDRB
+//#define CPU_LOAD_PROBE_PIN 1
+
+// Optional hot path instrumentation. When defined, run times of interrupt
+// service routines and scheduler tasks, a histogram of effect loop periods,
+// and time spent asleep, are collected into variable instrumentationData. See
+// Instrumentation.h. Comment out to disable.
+//#define INSTRUMENTATION
+// Number and width of loop period histogram bins. Width is given in timebase
+// ticks (0.5 us).
+#define INSTRUMENTATION_BINS 16
+#define INSTRUMENTATION_BIN_WIDTH 100
+
+// Optional echo trace recording. When defined, raw distance sensor pings are
+// recorded into variable echoTrace, to be replayed on the build host. See
+// EchoTrace.h. Comment out to disable.
+//#define ECHO_TRACE
+// Number of recorded pings. Each ping takes 6 bytes of memory.
+#define ECHO_TRACE_LENGTH 64
+// Number of pings recorded after presence is first detected. Recording is
+// frozen after them.
+#define ECHO_TRACE_POST_TRIGGER 16
@@ -9,35 +9,198 @@
 #include "config.h"
 
 #include <avr/interrupt.h>
-#include <util/delay.h>
 
+#include "DMXSerial.h"
 #include "IndicatorController.h"
-#include "SingleChannelFlickeringDmxController.h"
+#include "FlickeringDmxController.h"
 #include "DistanceSensorController.h"
+#include "DistanceFilter.h"
+#include "EchoTrace.h"
+#include "PresenceDetector.h"
+#include "Instrumentation.h"
+#include "PowerReduction.h"
+#include "Scheduler.h"
 
-// Temp, needed for testing only
-#include "DMXSerial.h"
+// Controllers are global so that the task functions can reach them.
+IndicatorController indicator(20);
+DistanceSensorController distanceSensorController;
+DistanceFilter distanceFilters[DISTANCE_SENSOR_COUNT];
+FlickeringDmxController dmx;
+// Thresholds are converted to millimeters at compile time. Dwell times are in
+// scheduler ticks, which are milliseconds.
+PresenceDetector presenceDetector(
+    DISTANCE_THRESHOLD_ENTER * 10,
+    DISTANCE_THRESHOLD_EXIT * 10,
+    PRESENCE_ENTER_DWELL,
+    PRESENCE_EXIT_DWELL
+);
+
+// Effect task index, for triggering it when presence changes
+int8_t effectTask = -1;
+
+// Dmx start addresses of the lights
+static const uint16_t FIXTURE_ADDRESS_LIST[] = FIXTURE_ADDRESSES;
+
+// Latest filtered distance of each sensor in millimeters. Sensors that see
+// nothing in range or are faulty report 0xffff.
+uint16_t sensorDistances[DISTANCE_SENSOR_COUNT];
+
+// Shortest distance of all sensors in millimeters. Nothing is present before
+// first measurement, or if no sensor has reported for
+// DISTANCE_SENSOR_STALE_TIME.
+uint16_t distance = 0xffff;
+
+// If power save mode is on
+bool isPowerSaving = false;
+// Scheduler time when presence last ended
+uint16_t absentSince = 0;
+
+// Scheduler time of last fresh measurement
+uint16_t freshTime = 0;
+// Timebase value at end of the ping of last fresh measurement. That is the
+// falling echo edge, or the echo timeout for out of range pings.
+uint16_t freshTimestamp = 0;
+
+void runIndicator() {
+    indicator.run();
+}
+
+// Lowers dmx refresh and ping rates when nobody has been present for a while,
+// and restores them as soon as something comes near.
+void updatePowerSave(bool isPresent, uint16_t now) {
+    if (isPowerSaving) {
+        if (distance < DISTANCE_THRESHOLD_ENTER * 10) {
+            isPowerSaving = false;
+            DMXSerial.refreshRate(DMX_REFRESH_RATE);
+            distanceSensorController.setPingRecovery(
+                DISTANCE_SENSOR_PING_RECOVERY
+            );
+            absentSince = now;
+        }
+        return;
+    }
+
+    if (isPresent) {
+        absentSince = now;
+    }
+    else if ((uint16_t)(now - absentSince) >= POWER_SAVE_DELAY) {
+        isPowerSaving = true;
+        DMXSerial.refreshRate(POWER_SAVE_DMX_REFRESH_RATE);
+        distanceSensorController.setPingRecovery(POWER_SAVE_PING_RECOVERY);
+    }
+}
+
+void runDistanceSensor() {
+    uint16_t now = Scheduler::getTicks();
+
+    // Drain all measurements received since previous run
+    DistanceMeasurement measurement;
+    bool isUpdated = false;
+    while (distanceSensorController.read(measurement)) {
+        uint8_t sensor = measurement.sensor;
+        switch (measurement.status) {
+            case DISTANCE_VALID:
+                sensorDistances[sensor] =
+                    distanceFilters[sensor].add(measurement.distance);
+                freshTimestamp = measurement.timestamp;
+                isUpdated = true;
+                break;
+            case DISTANCE_OUT_OF_RANGE:
+                sensorDistances[sensor] = 0xffff;
+                // Once the target is gone, its filtered distance must not
+                // make the next target look like an outlier
+                distanceFilters[sensor].addMiss();
+                freshTimestamp = measurement.timestamp;
+                isUpdated = true;
+                break;
+            case DISTANCE_SENSOR_FAULT:
+                // Faulty sensor must not keep the effect going
+                sensorDistances[sensor] = 0xffff;
+                distanceFilters[sensor].addMiss();
+                break;
+        }
+    }
+
+    if (isUpdated) {
+        freshTime = now;
+        distance = 0xffff;
+        for (uint8_t i = 0; i < DISTANCE_SENSOR_COUNT; i++) {
+            if (sensorDistances[i] < distance) {
+                distance = sensorDistances[i];
+            }
+        }
+    }
+    else if ((uint16_t)(now - freshTime) >= DISTANCE_SENSOR_STALE_TIME) {
+        // No fresh data, do not act on the last known distance
+        distance = 0xffff;
+    }
+
+    bool wasPresent = presenceDetector.isPresent();
+    bool isPresent = presenceDetector.update(distance, now);
+
+    updatePowerSave(isPresent, now);
+
+    if (isPresent == wasPresent) {
+        return;
+    }
+
+    dmx.setFlickerEnabled(isPresent);
+    if (isPresent) {
+        ECHO_TRACE_TRIGGER();
+    }
+    if (isUpdated) {
+        INSTRUMENT_LATENCY_BEGIN(freshTimestamp);
+    }
+#ifdef SENSOR_EVENT_DRIVEN
+    Scheduler::trigger(effectTask);
+#endif
+}
+
+void runEffect() {
+    INSTRUMENT_LOOP(EFFECT_PERIOD);
+
+    dmx.run();
+}
 
 int main() {
-    IndicatorController indicator(C, 0, 20);
-    DistanceSensorController distanceSensorController(C, 2, C, 3);
-    SingleChannelFlickeringDmxController dmx(
-        1,
-        LIGHT_BRIGHTNESS_BASELINE,
-        LIGHT_FLICKER_INTENSITY
+    CPU_LOAD_PROBE_INIT();
+    initializePowerReduction();
+
+    for (uint8_t i = 0; i < DISTANCE_SENSOR_COUNT; i++) {
+        sensorDistances[i] = 0xffff;
+    }
+
+    for (
+        uint8_t i = 0;
+        i < sizeof(FIXTURE_ADDRESS_LIST) / sizeof(uint16_t);
+        i++
+    ) {
+        dmx.addFixture(
+            FIXTURE_PROFILE,
+            FIXTURE_ADDRESS_LIST[i],
+            LIGHT_BRIGHTNESS_BASELINE,
+            LIGHT_FLICKER_INTENSITY,
+            FLICKER_WAVEFORM
+        );
+    }
+
+    Scheduler scheduler;
+    scheduler.addTask(runIndicator, INDICATOR_PERIOD, INDICATOR_BUDGET);
+    int8_t distanceSensorTask = scheduler.addTask(
+        runDistanceSensor,
+        DISTANCE_SENSOR_PERIOD,
+        DISTANCE_SENSOR_BUDGET
     );
+    effectTask = scheduler.addTask(runEffect, EFFECT_PERIOD, EFFECT_BUDGET);
 
-    sei();
+#ifdef SENSOR_EVENT_DRIVEN
+    distanceSensorController.setMeasurementTask(distanceSensorTask);
+#else
+    (void)distanceSensorTask;
+#endif
 
-    // Temp, to be able to test with the particular multichannel dmx light used
-    // in testing.
-    DMXSerial.write(1/*channel*/ + 4, 255);
+    sei();
 
-    while (true) {
-         indicator.run();
-         float distance = distanceSensorController.run();
-         dmx.setFlickerEnabled(distance < DISTANCE_THRESHOLD);
-         dmx.run();
-        _delay_ms(LOOP_DELAY);
-    }
+    distanceSensorController.start();
+    scheduler.run();
 }
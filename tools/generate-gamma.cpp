@@ -0,0 +1,42 @@
+// Generates the gamma correction table for the firmware. Run on the build
+// host, output is a header file written to standard output.
+//
+// The table maps 8 bit perceptual brightness to 16 bit linear light output,
+// so that equal steps of effect value look like equal steps of brightness.
+// High byte of an entry is the coarse dmx value and low byte the fine value.
+// Gamma exponent can be given as the only argument.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define GAMMA_LENGTH 256
+
+/// Default gamma exponent, typical for incandescent and dimmed led fixtures
+#define DEFAULT_GAMMA 2.2
+
+int main(int argc, char** argv) {
+    double gamma = argc > 1 ? atof(argv[1]) : DEFAULT_GAMMA;
+    if (gamma <= 0) {
+        fprintf(stderr, "Gamma must be positive\n");
+        return 1;
+    }
+
+    printf("// Gamma correction table, gamma %.2f.\n", gamma);
+    printf("// Generated by tools/generate-gamma.cpp. Do not edit.\n\n");
+    printf("#ifndef _H_GAMMA_TABLE\n");
+    printf("#define _H_GAMMA_TABLE\n\n");
+    printf("#include <avr/pgmspace.h>\n");
+    printf("#include <stdint.h>\n\n");
+    printf("#define GAMMA_LENGTH %d\n\n", GAMMA_LENGTH);
+
+    printf("static const uint16_t GAMMA_TABLE[GAMMA_LENGTH] PROGMEM = {");
+    for (int i = 0; i < GAMMA_LENGTH; i++) {
+        double level = pow(i / (double)(GAMMA_LENGTH - 1), gamma);
+        printf("%s%6ld,", i % 8 ? "" : "\n   ", lround(level * 0xffff));
+    }
+    printf("\n};\n\n");
+
+    printf("#endif\n");
+    return 0;
+}
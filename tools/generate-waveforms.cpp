@@ -0,0 +1,128 @@
+// Generates flicker waveform tables for the firmware. Run on the build host,
+// output is a header file written to standard output.
+//
+// Each waveform is a loop of WAVEFORM_LENGTH signed samples, normalized to
+// full int8_t range. Waveforms are made from random noise, which is shaped by
+// filtering so that it resembles the flicker of the real light source.
+// Filtering wraps around the end of the table, so that the loop has no seam.
+// The random source has a fixed seed, so that every build produces the same
+// tables.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define WAVEFORM_LENGTH 256
+
+/// Fixed seed pseudorandom generator, uniform between -1 and 1.
+static double noise() {
+    static uint32_t state = 20191031;
+    state = state * 1664525 + 1013904223;
+    return (state >> 8) / (double)(1 << 23) - 1.0;
+}
+
+/// Circular one pole low pass filter. Run twice around the loop, so that the
+/// start of the table is filtered with the end already in the state.
+static void lowPass(double* samples, double coefficient) {
+    double state = 0;
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < WAVEFORM_LENGTH; i++) {
+            state += coefficient * (samples[i] - state);
+            if (round == 1) {
+                samples[i] = state;
+            }
+        }
+    }
+}
+
+/// Removes mean and scales to full int8_t range.
+static void normalize(double* samples) {
+    double mean = 0;
+    for (int i = 0; i < WAVEFORM_LENGTH; i++) {
+        mean += samples[i];
+    }
+    mean /= WAVEFORM_LENGTH;
+
+    double peak = 0;
+    for (int i = 0; i < WAVEFORM_LENGTH; i++) {
+        samples[i] -= mean;
+        if (fabs(samples[i]) > peak) {
+            peak = fabs(samples[i]);
+        }
+    }
+
+    for (int i = 0; i < WAVEFORM_LENGTH; i++) {
+        samples[i] *= 127 / peak;
+    }
+}
+
+/// Candle: slow, gentle wavering with occasional small dips.
+static void candle(double* samples) {
+    for (int i = 0; i < WAVEFORM_LENGTH; i++) {
+        samples[i] = noise();
+    }
+    lowPass(samples, 0.15);
+    lowPass(samples, 0.15);
+}
+
+/// Fire: slow swells with faster flicker on top.
+static void fire(double* samples) {
+    double slow[WAVEFORM_LENGTH];
+    for (int i = 0; i < WAVEFORM_LENGTH; i++) {
+        slow[i] = noise();
+        samples[i] = noise();
+    }
+    lowPass(slow, 0.05);
+    lowPass(slow, 0.05);
+    lowPass(samples, 0.5);
+    normalize(slow);
+    normalize(samples);
+    for (int i = 0; i < WAVEFORM_LENGTH; i++) {
+        samples[i] = 0.6 * slow[i] + 0.4 * samples[i];
+    }
+}
+
+/// Lightning: mostly dark, with a few sharp flashes that decay quickly.
+static void lightning(double* samples) {
+    for (int i = 0; i < WAVEFORM_LENGTH; i++) {
+        samples[i] = 0;
+    }
+
+    const int flashes[] = { 20, 27, 31, 140, 146, 210 };
+    for (unsigned f = 0; f < sizeof(flashes) / sizeof(int); f++) {
+        double level = 0.6 + 0.4 * fabs(noise());
+        for (int i = 0; i < 12; i++) {
+            samples[(flashes[f] + i) % WAVEFORM_LENGTH] += level;
+            level *= 0.55;
+        }
+    }
+}
+
+static void print(const char* name, void (*generate)(double*)) {
+    double samples[WAVEFORM_LENGTH];
+    generate(samples);
+    normalize(samples);
+
+    printf("static const int8_t %s[WAVEFORM_LENGTH] PROGMEM = {", name);
+    for (int i = 0; i < WAVEFORM_LENGTH; i++) {
+        printf("%s%4d,", i % 12 ? "" : "\n   ", (int)lround(samples[i]));
+    }
+    printf("\n};\n\n");
+}
+
+int main() {
+    printf("// Flicker waveform tables.\n");
+    printf("// Generated by tools/generate-waveforms.cpp. Do not edit.\n\n");
+    printf("#ifndef _H_WAVEFORM_TABLES\n");
+    printf("#define _H_WAVEFORM_TABLES\n\n");
+    printf("#include <avr/pgmspace.h>\n");
+    printf("#include <stdint.h>\n\n");
+    printf("#define WAVEFORM_LENGTH %d\n\n", WAVEFORM_LENGTH);
+
+    print("WAVEFORM_CANDLE_TABLE", candle);
+    print("WAVEFORM_FIRE_TABLE", fire);
+    print("WAVEFORM_LIGHTNING_TABLE", lightning);
+
+    printf("#endif\n");
+    return 0;
+}